@@ -0,0 +1,136 @@
+#include "ADCSampler.h"
+
+volatile uint16_t ADCSampler::_enabled = 0;
+volatile uint16_t ADCSampler::_ready = 0;
+uint8_t ADCSampler::_shift[ADCSAMPLER_NB_CHANNELS];
+uint8_t ADCSampler::_count[ADCSAMPLER_NB_CHANNELS];
+uint32_t ADCSampler::_sum[ADCSAMPLER_NB_CHANNELS];
+uint16_t ADCSampler::_result[ADCSAMPLER_NB_CHANNELS];
+uint8_t ADCSampler::_converting = 0;
+uint8_t ADCSampler::_next = 0;
+
+ISR(ADC_vect)
+{
+    ADCSampler::sample();
+}
+
+//next attached channel (round robin)
+uint8_t ADCSampler::nextChannel(uint8_t channel)
+{
+    for (uint8_t i = 1; i <= ADCSAMPLER_NB_CHANNELS; i++)
+    {
+        uint8_t candidate = (channel + i) % ADCSAMPLER_NB_CHANNELS;
+        if (_enabled & (1U << candidate))
+            return candidate;
+    }
+    return channel;
+}
+
+void ADCSampler::selectChannel(uint8_t channel)
+{
+    //AVcc reference, channels 8-15 need MUX5 (ADCSRB also selects free running trigger : 0)
+    ADMUX = _BV(REFS0) | (channel & 0x07);
+    ADCSRB = (channel & 0x08) ? _BV(MUX5) : 0;
+}
+
+void ADCSampler::start(uint8_t channel)
+{
+    selectChannel(channel);
+    _converting = channel;
+    _next = channel;
+
+    //enable, start, auto trigger (free running), interrupt, prescaler 128
+    ADCSRA = _BV(ADEN) | _BV(ADSC) | _BV(ADATE) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+}
+
+void ADCSampler::stop()
+{
+    //back to Arduino default (analogRead can be used again)
+    ADCSRA = _BV(ADEN) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+}
+
+bool ADCSampler::attach(uint8_t channel, uint8_t oversampling)
+{
+    if (channel >= ADCSAMPLER_NB_CHANNELS)
+        return false;
+
+    uint8_t shift = 0;
+    while (shift < ADCSAMPLER_MAX_OVERSAMPLING_SHIFT && (2 << shift) <= oversampling)
+        shift++;
+
+    //digital input buffer is useless on an analog input (and consumes power)
+    if (channel < 8)
+        DIDR0 |= _BV(channel);
+    else
+        DIDR2 |= _BV(channel - 8);
+
+    cli();
+    _shift[channel] = shift;
+    _count[channel] = 0;
+    _sum[channel] = 0;
+    _ready &= ~(1U << channel);
+    bool wasRunning = _enabled;
+    _enabled |= (1U << channel);
+    sei();
+
+    if (!wasRunning)
+        start(channel);
+
+    return true;
+}
+
+void ADCSampler::detach(uint8_t channel)
+{
+    if (channel >= ADCSAMPLER_NB_CHANNELS)
+        return;
+
+    cli();
+    _enabled &= ~(1U << channel);
+    _ready &= ~(1U << channel);
+    sei();
+
+    if (channel < 8)
+        DIDR0 &= ~_BV(channel);
+    else
+        DIDR2 &= ~_BV(channel - 8);
+
+    if (!_enabled)
+        stop();
+}
+
+bool ADCSampler::read(uint8_t channel, uint16_t &value)
+{
+    if (!(_ready & (1U << channel)))
+        return false;
+
+    cli();
+    value = _result[channel];
+    _ready &= ~(1U << channel);
+    sei();
+    return true;
+}
+
+void ADCSampler::sample()
+{
+    uint16_t value = ADC;
+    uint8_t channel = _converting;
+
+    //conversion started with this interrupt uses previous selection, so select the one after
+    _converting = _next;
+    _next = nextChannel(_next);
+    selectChannel(_next);
+
+    //channel may have been detached since its conversion started
+    if (!(_enabled & (1U << channel)))
+        return;
+
+    _sum[channel] += value;
+    if (++_count[channel] < (1 << _shift[channel]))
+        return;
+
+    //decimation : average of 2^n samples with 16 bits scale (extra resolution is kept)
+    _result[channel] = _sum[channel] << (ADCSAMPLER_MAX_OVERSAMPLING_SHIFT - _shift[channel]);
+    _sum[channel] = 0;
+    _count[channel] = 0;
+    _ready |= (1U << channel);
+}
\ No newline at end of file
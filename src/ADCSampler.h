@@ -0,0 +1,39 @@
+#ifndef ADCSampler_h
+#define ADCSampler_h
+
+#include <Arduino.h>
+
+//Shared ADC engine : converter runs in free running mode and its interrupt samples attached channels (A0-A15) in turn
+//Each channel accumulates 2^n samples (oversampling) then its average is given with 16 bits scale (ADC x 64)
+//In free running mode, next conversion is already started when interrupt occurs :
+//the channel selected in interrupt is the one of the conversion after next (pipeline of 2 conversions)
+//ADC clock is 125kHz (9615 samples/s shared by channels)
+
+#define ADCSAMPLER_NB_CHANNELS 16
+#define ADCSAMPLER_MAX_OVERSAMPLING_SHIFT 6 //64 samples
+
+class ADCSampler
+{
+private:
+  static volatile uint16_t _enabled; //attached channels (bit mask)
+  static volatile uint16_t _ready;   //channels having a new average (bit mask)
+  static uint8_t _shift[ADCSAMPLER_NB_CHANNELS];
+  static uint8_t _count[ADCSAMPLER_NB_CHANNELS];
+  static uint32_t _sum[ADCSAMPLER_NB_CHANNELS];
+  static uint16_t _result[ADCSAMPLER_NB_CHANNELS];
+  static uint8_t _converting; //channel of the running conversion
+  static uint8_t _next;       //channel of the next conversion
+
+  static uint8_t nextChannel(uint8_t channel);
+  static void selectChannel(uint8_t channel);
+  static void start(uint8_t channel);
+  static void stop();
+
+public:
+  static bool attach(uint8_t channel, uint8_t oversampling); //oversampling is rounded down to a power of 2 (1->64)
+  static void detach(uint8_t channel);
+  static bool read(uint8_t channel, uint16_t &value); //return true if a new average is available (0->65472)
+  static void sample();                               //called by interrupt
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,233 @@
+#include "ActuatorScheduler.h"
+
+Actuator *ActuatorScheduler::_pending = NULL;
+uint8_t ActuatorScheduler::_maxStarts = ACTUATORSCHEDULER_DEFAULT_MAX_STARTS;
+uint16_t ActuatorScheduler::_inrushTime = ACTUATORSCHEDULER_DEFAULT_INRUSH_TIME;
+uint16_t ActuatorScheduler::_deadTime = ACTUATORSCHEDULER_DEFAULT_DEAD_TIME;
+uint16_t ActuatorScheduler::_minDwell = ACTUATORSCHEDULER_DEFAULT_MIN_DWELL;
+uint32_t ActuatorScheduler::_starts[ACTUATORSCHEDULER_MAX_STARTS];
+uint8_t ActuatorScheduler::_nextStart = 0;
+uint8_t ActuatorScheduler::_holdCount = 0;
+
+void ActuatorScheduler::setup(uint8_t maxStarts, uint16_t inrushTime, uint16_t deadTime, uint16_t minDwell)
+{
+    _maxStarts = constrain(maxStarts, 1, ACTUATORSCHEDULER_MAX_STARTS);
+    _inrushTime = inrushTime;
+    _deadTime = deadTime;
+    _minDwell = minDwell;
+    if (_nextStart >= _maxStarts)
+        _nextStart = 0;
+
+    Serial.print(F("[setup][Config] Actuators="));
+    Serial.print(_maxStarts);
+    Serial.print(',');
+    Serial.print(_inrushTime);
+    Serial.print(',');
+    Serial.print(_deadTime);
+    Serial.print(',');
+    Serial.println(_minDwell);
+}
+
+bool ActuatorScheduler::canApply(Actuator *actuator, uint32_t now)
+{
+    //relay contacts need to rest between 2 transitions
+    if (now - actuator->_lastChange < _minDwell)
+        return false;
+
+    Actuator *guard = actuator->_guard;
+
+    switch (actuator->_kind)
+    {
+    case Actuator::Relay:
+        return true;
+
+    case Actuator::Direction:
+        //never switch direction under load
+        return !guard || (!guard->_state && now - guard->_lastChange >= _deadTime);
+
+    case Actuator::Motor:
+    {
+        if (guard)
+        {
+            //wait for direction relay (or opposite motor) to be in place
+            if (guard->_queued)
+                return false;
+            //direction relay contacts need to settle before load is applied
+            if (guard->_kind == Actuator::Direction && now - guard->_lastChange < _minDwell)
+                return false;
+            //opposite motor need to be stopped since deadTime
+            if (guard->_kind == Actuator::Motor && (guard->_state || now - guard->_lastChange < _deadTime))
+                return false;
+        }
+
+        //count motors started during inrushTime
+        uint8_t nbStarts = 0;
+        for (uint8_t i = 0; i < _maxStarts; i++)
+            if (_starts[i] && now - _starts[i] < _inrushTime)
+                nbStarts++;
+        return nbStarts < _maxStarts;
+    }
+    }
+
+    return true;
+}
+
+void ActuatorScheduler::enqueue(Actuator *actuator)
+{
+    if (actuator->_queued)
+        return;
+
+    //add at the end of the queue (requests are applied in order)
+    Actuator **last = &_pending;
+    while (*last)
+        last = &(*last)->_next;
+    *last = actuator;
+    actuator->_next = NULL;
+    actuator->_queued = true;
+}
+
+void ActuatorScheduler::dequeue(Actuator *actuator)
+{
+    if (!actuator->_queued)
+        return;
+
+    for (Actuator **current = &_pending; *current; current = &(*current)->_next)
+    {
+        if (*current == actuator)
+        {
+            *current = actuator->_next;
+            break;
+        }
+    }
+    actuator->_next = NULL;
+    actuator->_queued = false;
+}
+
+void ActuatorScheduler::request(Actuator *actuator)
+{
+    enqueue(actuator);
+    if (!_holdCount)
+        run();
+}
+
+void ActuatorScheduler::hold()
+{
+    _holdCount++;
+}
+
+bool ActuatorScheduler::release()
+{
+    if (_holdCount)
+        _holdCount--;
+    if (_holdCount)
+        return _pending != NULL;
+    return run();
+}
+
+bool ActuatorScheduler::run()
+{
+    uint32_t now = millis();
+    Actuator **current = &_pending;
+
+    while (*current)
+    {
+        Actuator *actuator = *current;
+
+        if (!canApply(actuator, now))
+        {
+            current = &actuator->_next;
+            continue;
+        }
+
+        //remove from queue then apply
+        *current = actuator->_next;
+        actuator->_next = NULL;
+        actuator->_queued = false;
+
+        actuator->write(actuator->_target);
+        if (actuator->_kind == Actuator::Motor && actuator->_target)
+        {
+            _starts[_nextStart] = now;
+            _nextStart = (_nextStart + 1) % _maxStarts;
+        }
+    }
+
+    return _pending != NULL;
+}
+
+//------------------------------------------
+void Actuator::write(bool on)
+{
+    digitalWrite(_pin, (on != _invert) ? HIGH : LOW);
+    _state = on;
+    _lastChange = millis();
+}
+
+Actuator::~Actuator()
+{
+    if (_pin == 0xFF)
+        return;
+
+    //release output immediately
+    ActuatorScheduler::dequeue(this);
+    write(false);
+}
+
+void Actuator::begin(uint8_t pin, bool invert, Kind kind, Actuator *guard)
+{
+    _pin = pin;
+    _invert = invert;
+    _kind = kind;
+    _guard = guard;
+
+    pinMode(_pin, OUTPUT);
+    write(false);
+    _target = false;
+    //first transition doesn't have to wait for dwell or dead time
+    _lastChange = millis() - 0xFFFF;
+}
+
+void Actuator::set(bool on)
+{
+    if (_pin == 0xFF)
+        return;
+
+    _target = on;
+
+    //already in this state : cancel pending transition
+    if (on == _state)
+    {
+        ActuatorScheduler::dequeue(this);
+        return;
+    }
+
+    //stopping a motor is never delayed
+    if (!on && _kind == Motor)
+    {
+        ActuatorScheduler::dequeue(this);
+        write(false);
+        return;
+    }
+
+    ActuatorScheduler::request(this);
+}
+
+bool Actuator::isOn()
+{
+    return _state;
+}
+
+bool Actuator::target()
+{
+    return _target;
+}
+
+bool Actuator::isPending()
+{
+    return _queued;
+}
+
+uint32_t Actuator::lastChange()
+{
+    return _lastChange;
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#ifndef ActuatorScheduler_h
+#define ActuatorScheduler_h
+
+#include <Arduino.h>
+
+//Board-wide scheduler of relay transitions
+//HADevices never write their outputs directly : they request a state to their Actuators
+//Requests are applied immediately when electrical limits allow it, otherwise they are queued (FIFO) :
+// - Relay : minimum dwell time between 2 transitions
+// - Motor : switching on is limited to maxStarts during inrushTime (board-wide)
+//           and waits deadTime after its interlocked motor (guard) stopped
+//           switching off is never delayed
+// - Direction : only changes when its motor (guard) is off since deadTime
+//While held (group commands, rules), requests are only queued then applied together in one pass by last release()
+
+#define ACTUATORSCHEDULER_MAX_STARTS 8 //upper limit of maxStarts setting
+
+#define ACTUATORSCHEDULER_DEFAULT_MAX_STARTS 2
+#define ACTUATORSCHEDULER_DEFAULT_INRUSH_TIME 300 //ms
+#define ACTUATORSCHEDULER_DEFAULT_DEAD_TIME 500   //ms
+#define ACTUATORSCHEDULER_DEFAULT_MIN_DWELL 100   //ms
+
+class Actuator;
+
+class ActuatorScheduler
+{
+private:
+  static Actuator *_pending; //queue of actuators waiting for their transition
+  static uint8_t _maxStarts;
+  static uint16_t _inrushTime;
+  static uint16_t _deadTime;
+  static uint16_t _minDwell;
+  static uint32_t _starts[ACTUATORSCHEDULER_MAX_STARTS]; //time of last motor starts
+  static uint8_t _nextStart;
+  static uint8_t _holdCount; //hold() can be nested
+
+  static bool canApply(Actuator *actuator, uint32_t now);
+
+public:
+  static void setup(uint8_t maxStarts, uint16_t inrushTime, uint16_t deadTime, uint16_t minDwell);
+  static void enqueue(Actuator *actuator);
+  static void dequeue(Actuator *actuator);
+  static void request(Actuator *actuator); //queue then apply immediately (if not held and limits allow it)
+  static void hold();
+  static bool release(); //same return as run()
+  static bool run(); //return true if some transitions are still pending
+};
+
+class Actuator
+{
+  friend class ActuatorScheduler;
+
+public:
+  enum Kind : uint8_t
+  {
+    Relay,
+    Motor,
+    Direction
+  };
+
+private:
+  Actuator *_next = NULL;  //next in pending queue
+  Actuator *_guard = NULL; //interlocked actuator (motor of a direction relay, direction relay or opposite motor of a motor)
+  uint32_t _lastChange = 0;
+  uint8_t _pin = 0xFF;
+  Kind _kind = Relay;
+  bool _invert = false;
+  bool _state = false;  //output state
+  bool _target = false; //requested state
+  bool _queued = false;
+
+  void write(bool on);
+
+  Actuator(const Actuator &) = delete;
+  Actuator &operator=(const Actuator &) = delete;
+
+public:
+  Actuator() {}
+  ~Actuator();
+  void begin(uint8_t pin, bool invert, Kind kind = Relay, Actuator *guard = NULL);
+  void set(bool on);
+  bool isOn();     //output state
+  bool target();   //requested state (applied or not)
+  bool isPending(); //requested state not yet applied
+  uint32_t lastChange();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,126 @@
+#include "AnalogIn.h"
+
+//Home Assistant discovery
+static const char discoveryComponent[] PROGMEM = "sensor";
+static const char discoveryTemplate[] PROGMEM = "{\"name\":\"%i\",\"uniq_id\":\"%n_%i\",\"stat_t\":\"%b%i/value\",\"stat_cla\":\"measurement\",%d}";
+
+void AnalogIn::publish()
+{
+    _publishedValue = _value;
+    _hasPublished = true;
+    _evtMgr->addEvent((String(_id) + F("/value")).c_str(), String(_value, _decimals).c_str(), true);
+
+    //next publish can't happen before interval
+    _intervalTimer.setOnceTimeout(_interval);
+}
+
+AnalogIn::AnalogIn(JsonVariant config, EventManager *evtMgr)
+{
+    if (config["id"].isNull())
+        return;
+
+    if (config["pin"].isNull())
+        return;
+
+    //call Init with parsed values
+    init(config["id"].as<const char *>(), config["pin"].as<uint8_t>(), config["oversampling"] | (uint8_t)ANALOGIN_DEFAULT_OVERSAMPLING,
+         config["scale"] | 1.0f, config["offset"] | 0.0f, config["deadband"] | 0.0f,
+         config["decimals"] | (uint8_t)ANALOGIN_DEFAULT_DECIMALS, config["interval"] | (uint16_t)ANALOGIN_DEFAULT_INTERVAL, evtMgr);
+};
+
+AnalogIn::~AnalogIn()
+{
+    if (_initialized)
+        ADCSampler::detach(_channel);
+};
+
+void AnalogIn::init(const char *id, uint8_t pin, uint8_t oversampling, float scale, float offset, float deadband, uint8_t decimals, uint16_t interval, EventManager *evtMgr)
+{
+    Serial.print(F("[AnalogIn] Init("));
+    Serial.print(id);
+    Serial.print(',');
+    Serial.print(pin);
+    Serial.print(',');
+    Serial.print(oversampling);
+    Serial.println(')');
+
+    //only analog pins are accepted (A0=54 -> A15=69)
+    if (pin < A0 || pin >= A0 + ADCSAMPLER_NB_CHANNELS)
+    {
+        Serial.println(F("[AnalogIn][ERROR]Pin is not an analog input (54->69)"));
+        return;
+    }
+
+    //Check if pin is available
+    if (!isPinAvailable(pin))
+        return;
+
+    //save EventManager
+    _evtMgr = evtMgr;
+
+    //copy id
+    strcpy(_id, id);
+
+    //save settings
+    _channel = pin - A0;
+    _scale = scale;
+    _offset = offset;
+    _deadband = deadband;
+    _decimals = decimals;
+    _interval = interval;
+
+    //channel is sampled by ADC interrupt
+    ADCSampler::attach(_channel, oversampling);
+
+    _initialized = true;
+};
+
+//AnalogIn doesn't accept command
+void AnalogIn::mqttSubscribe(PubSubClient &mqttClient, const char *baseTopic){};
+void AnalogIn::mqttUnsubscribe(PubSubClient &mqttClient, const char *baseTopic){};
+bool AnalogIn::mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsigned int length)
+{
+    return false;
+};
+
+void AnalogIn::printStateValue(Print &out)
+{
+    if (_hasValue)
+        out.print(_value, _decimals);
+    else
+        out.print(F("null"));
+};
+
+bool AnalogIn::run()
+{
+    if (!_initialized)
+        return false;
+
+    //consume end of interval (isActive becomes false)
+    _intervalTimer.isTimeoutOver();
+
+    //pick up finished average (ADC x 64)
+    uint16_t raw;
+    if (ADCSampler::read(_channel, raw))
+    {
+        _value = (raw / 64.0) * _scale + _offset;
+        _hasValue = true;
+    }
+
+    //publish first value, then changes bigger than deadband (at most once per interval)
+    if (_hasValue && !_intervalTimer.isActive() && (!_hasPublished || fabs(_value - _publishedValue) > _deadband))
+        publish();
+
+    //sampling is done by interrupt, so always false is returned
+    return false;
+};
+
+bool AnalogIn::getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId)
+{
+    if (!_initialized || index)
+        return false;
+
+    component = discoveryComponent;
+    payloadTemplate = discoveryTemplate;
+    return true;
+};
\ No newline at end of file
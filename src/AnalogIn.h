@@ -0,0 +1,48 @@
+#ifndef AnalogIn_h
+#define AnalogIn_h
+
+#include "HADevice.h"
+
+#include "ADCSampler.h"
+#include "TimerWheel.h"
+
+//MQTT publish :
+//  ID/value
+//    ADC (0->1023) x scale + offset
+
+#define ANALOGIN_DEFAULT_OVERSAMPLING 64
+#define ANALOGIN_DEFAULT_DECIMALS 2
+#define ANALOGIN_DEFAULT_INTERVAL 1000 //ms
+
+class AnalogIn : public HADevice
+{
+private:
+  uint8_t _channel = 0; //A0-A15
+  float _scale = 1.0;
+  float _offset = 0.0;
+  float _deadband = 0.0;
+  uint8_t _decimals = ANALOGIN_DEFAULT_DECIMALS;
+  uint16_t _interval = ANALOGIN_DEFAULT_INTERVAL;
+  float _value = 0.0;
+  float _publishedValue = 0.0;
+  bool _hasValue = false;
+  bool _hasPublished = false;
+  WheelTimer _intervalTimer;
+
+  void publish();
+
+protected:
+  void printStateValue(Print &out) override;
+
+public:
+  AnalogIn(JsonVariant config, EventManager *evtMgr);
+  ~AnalogIn();
+  void init(const char *id, uint8_t pin, uint8_t oversampling, float scale, float offset, float deadband, uint8_t decimals, uint16_t interval, EventManager *evtMgr);
+  void mqttSubscribe(PubSubClient &mqttClient, const char *baseTopic) override;
+  void mqttUnsubscribe(PubSubClient &mqttClient, const char *baseTopic) override;
+  bool mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsigned int length) override;
+  bool run() override;
+  bool getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId) override;
+};
+
+#endif
\ No newline at end of file
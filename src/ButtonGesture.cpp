@@ -0,0 +1,104 @@
+#include "ButtonGesture.h"
+
+static const char gestureSingle[] PROGMEM = "single";
+static const char gestureDouble[] PROGMEM = "double";
+static const char gestureTriple[] PROGMEM = "triple";
+static const char gestureHold[] PROGMEM = "hold";
+static const char gestureRepeat[] PROGMEM = "repeat";
+static const char gestureRelease[] PROGMEM = "release";
+
+void ButtonGesture::begin(uint16_t clickTime, uint16_t holdTime, uint16_t repeatTime)
+{
+    _clickTime = clickTime;
+    _holdTime = holdTime;
+    _repeatTime = repeatTime;
+    _state = Idle;
+    _clicks = 0;
+    _timer.stop();
+}
+
+ButtonGesture::Gesture ButtonGesture::update(bool pressed, bool released)
+{
+    bool timeout = _timer.isTimeoutOver();
+
+    switch (_state)
+    {
+    case Idle:
+        if (pressed)
+        {
+            _clicks = 1;
+            _state = Pressed;
+            _timer.setOnceTimeout(_holdTime);
+        }
+        break;
+
+    case Pressed:
+        if (released)
+        {
+            //third click doesn't need to wait for another one
+            if (_clicks == 3)
+            {
+                _timer.stop();
+                _state = Idle;
+                return Triple;
+            }
+            _state = Released;
+            _timer.setOnceTimeout(_clickTime);
+        }
+        else if (timeout)
+        {
+            _state = Held;
+            _timer.setTimeout(_repeatTime);
+            return Hold;
+        }
+        break;
+
+    case Released:
+        if (pressed)
+        {
+            _clicks++;
+            _state = Pressed;
+            _timer.setOnceTimeout(_holdTime);
+        }
+        else if (timeout)
+        {
+            _state = Idle;
+            return (_clicks == 1) ? Single : Double;
+        }
+        break;
+
+    case Held:
+        if (released)
+        {
+            _timer.stop();
+            _state = Idle;
+            return Release;
+        }
+        if (timeout)
+            return Repeat;
+        break;
+    }
+
+    return None;
+}
+
+PGM_P ButtonGesture::name(Gesture gesture)
+{
+    switch (gesture)
+    {
+    case Single:
+        return gestureSingle;
+    case Double:
+        return gestureDouble;
+    case Triple:
+        return gestureTriple;
+    case Hold:
+        return gestureHold;
+    case Repeat:
+        return gestureRepeat;
+    case Release:
+        return gestureRelease;
+    default:
+        return NULL;
+    }
+}
\ No newline at end of file
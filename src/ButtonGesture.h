@@ -0,0 +1,53 @@
+#ifndef ButtonGesture_h
+#define ButtonGesture_h
+
+#include <Arduino.h>
+#include "TimerWheel.h"
+
+//Gesture recognizer of a push button (fed with debounced press/release edges)
+// - single/double/triple click : clicks separated by less than clickTime (triple is given on third release)
+// - hold : button pressed for more than holdTime
+// - repeat : every repeatTime while button is still held
+// - release : end of a hold
+
+#define BUTTONGESTURE_DEFAULT_CLICK_TIME 300  //ms
+#define BUTTONGESTURE_DEFAULT_HOLD_TIME 600   //ms
+#define BUTTONGESTURE_DEFAULT_REPEAT_TIME 500 //ms
+
+class ButtonGesture
+{
+public:
+  enum Gesture : uint8_t
+  {
+    None,
+    Single,
+    Double,
+    Triple,
+    Hold,
+    Repeat,
+    Release
+  };
+
+private:
+  enum State : uint8_t
+  {
+    Idle,
+    Pressed,  //button is down (click or hold)
+    Released, //button is up, waiting for another click
+    Held
+  };
+
+  WheelTimer _timer;
+  uint16_t _clickTime = BUTTONGESTURE_DEFAULT_CLICK_TIME;
+  uint16_t _holdTime = BUTTONGESTURE_DEFAULT_HOLD_TIME;
+  uint16_t _repeatTime = BUTTONGESTURE_DEFAULT_REPEAT_TIME;
+  State _state = Idle;
+  uint8_t _clicks = 0;
+
+public:
+  void begin(uint16_t clickTime, uint16_t holdTime, uint16_t repeatTime);
+  Gesture update(bool pressed, bool released); //edges of the button
+  static PGM_P name(Gesture gesture);          //name used as MQTT payload
+};
+
+#endif
\ No newline at end of file
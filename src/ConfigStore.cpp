@@ -0,0 +1,368 @@
+#include "ConfigStore.h"
+
+static bool isWhitespace(uint8_t c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+//------------------------------------------
+// JSON scanning helpers : take a position in EEPROM and return position after the element
+// (CONFIG_INVALID_POS if JSON is incorrect)
+uint16_t ConfigStore::skipWhitespace(uint16_t pos)
+{
+    while (pos < CONFIG_MAX_LENGTH && isWhitespace(EEPROM.read(pos)))
+        pos++;
+    return (pos < CONFIG_MAX_LENGTH) ? pos : CONFIG_INVALID_POS;
+}
+
+uint16_t ConfigStore::skipString(uint16_t pos)
+{
+    if (pos >= CONFIG_MAX_LENGTH || EEPROM.read(pos) != '"')
+        return CONFIG_INVALID_POS;
+
+    for (pos++; pos < CONFIG_MAX_LENGTH; pos++)
+    {
+        uint8_t c = EEPROM.read(pos);
+        if (!c)
+            return CONFIG_INVALID_POS;
+        if (c == '\\')
+            pos++;
+        else if (c == '"')
+            return pos + 1;
+    }
+    return CONFIG_INVALID_POS;
+}
+
+uint16_t ConfigStore::skipValue(uint16_t pos)
+{
+    pos = skipWhitespace(pos);
+    if (pos == CONFIG_INVALID_POS)
+        return pos;
+
+    uint8_t c = EEPROM.read(pos);
+
+    //string
+    if (c == '"')
+        return skipString(pos);
+
+    //object or array
+    if (c == '{' || c == '[')
+    {
+        uint8_t depth = 0;
+        while (pos < CONFIG_MAX_LENGTH)
+        {
+            c = EEPROM.read(pos);
+            if (!c)
+                return CONFIG_INVALID_POS;
+            if (c == '"')
+            {
+                pos = skipString(pos);
+                if (pos == CONFIG_INVALID_POS)
+                    return pos;
+                continue;
+            }
+            if (c == '{' || c == '[')
+                depth++;
+            else if ((c == '}' || c == ']') && !--depth)
+                return pos + 1;
+            pos++;
+        }
+        return CONFIG_INVALID_POS;
+    }
+
+    //number, true, false, null
+    while (pos < CONFIG_MAX_LENGTH)
+    {
+        c = EEPROM.read(pos);
+        if (!c || c == ',' || c == '}' || c == ']' || isWhitespace(c))
+            return pos;
+        pos++;
+    }
+    return CONFIG_INVALID_POS;
+}
+
+//check if string at pos is exactly str (str is in PROGMEM)
+bool ConfigStore::isString(uint16_t pos, const char *str)
+{
+    if (pos >= CONFIG_MAX_LENGTH || EEPROM.read(pos++) != '"')
+        return false;
+
+    char c;
+    while ((c = pgm_read_byte(str++)))
+        if (pos >= CONFIG_MAX_LENGTH || EEPROM.read(pos++) != (uint8_t)c)
+            return false;
+
+    return pos < CONFIG_MAX_LENGTH && EEPROM.read(pos) == '"';
+}
+
+//------------------------------------------
+// Look for HADevices array and entry having this id
+// arrayInsertPos : position after last entry (or after '[' if array is empty)
+// entryStart/entryEnd : position of the entry ({...}), CONFIG_INVALID_POS if id is not found
+// return false if JSON is incorrect or HADevices is missing
+bool ConfigStore::locateDevice(const char *id, uint16_t &arrayInsertPos, bool &arrayEmpty, uint16_t &entryStart, uint16_t &entryEnd)
+{
+    entryStart = entryEnd = CONFIG_INVALID_POS;
+
+    uint16_t pos = skipWhitespace(0);
+    if (pos == CONFIG_INVALID_POS || EEPROM.read(pos) != '{')
+        return false;
+    pos++;
+
+    //look for HADevices in root object
+    while (true)
+    {
+        pos = skipWhitespace(pos);
+        if (pos == CONFIG_INVALID_POS || EEPROM.read(pos) == '}')
+            return false;
+
+        bool isHADevices = isString(pos, PSTR("HADevices"));
+        pos = skipWhitespace(skipString(pos));
+        if (pos == CONFIG_INVALID_POS || EEPROM.read(pos) != ':')
+            return false;
+        pos = skipWhitespace(pos + 1);
+        if (pos == CONFIG_INVALID_POS)
+            return false;
+
+        if (isHADevices)
+            break;
+
+        pos = skipWhitespace(skipValue(pos));
+        if (pos == CONFIG_INVALID_POS)
+            return false;
+        if (EEPROM.read(pos) == ',')
+            pos++;
+    }
+
+    if (EEPROM.read(pos) != '[')
+        return false;
+    pos++;
+    arrayInsertPos = pos;
+    arrayEmpty = true;
+
+    //for each entry of HADevices
+    while (true)
+    {
+        pos = skipWhitespace(pos);
+        if (pos == CONFIG_INVALID_POS)
+            return false;
+
+        uint8_t c = EEPROM.read(pos);
+        if (c == ']')
+            return true;
+        if (c == ',')
+        {
+            pos++;
+            continue;
+        }
+        if (c != '{')
+            return false;
+
+        uint16_t start = pos;
+        bool idMatch = false;
+        pos++;
+
+        //for each member of the entry
+        while (true)
+        {
+            pos = skipWhitespace(pos);
+            if (pos == CONFIG_INVALID_POS)
+                return false;
+
+            c = EEPROM.read(pos);
+            if (c == '}')
+            {
+                pos++;
+                break;
+            }
+            if (c == ',')
+            {
+                pos++;
+                continue;
+            }
+
+            bool isId = isString(pos, PSTR("id"));
+            pos = skipWhitespace(skipString(pos));
+            if (pos == CONFIG_INVALID_POS || EEPROM.read(pos) != ':')
+                return false;
+            pos = skipWhitespace(pos + 1);
+            if (pos == CONFIG_INVALID_POS)
+                return false;
+
+            //compare id value (id is in RAM)
+            if (isId && EEPROM.read(pos) == '"')
+            {
+                uint16_t valuePos = pos + 1;
+                const char *idChar = id;
+                while (*idChar && valuePos < CONFIG_MAX_LENGTH && EEPROM.read(valuePos) == (uint8_t)*idChar)
+                {
+                    idChar++;
+                    valuePos++;
+                }
+                idMatch = !*idChar && valuePos < CONFIG_MAX_LENGTH && EEPROM.read(valuePos) == '"';
+            }
+
+            pos = skipValue(pos);
+            if (pos == CONFIG_INVALID_POS)
+                return false;
+        }
+
+        arrayInsertPos = pos;
+        arrayEmpty = false;
+
+        if (idMatch)
+        {
+            entryStart = start;
+            entryEnd = pos;
+            return true;
+        }
+    }
+}
+
+//------------------------------------------
+// Replace EEPROM bytes [start,end[ by text (preceded by ',' if withSeparator)
+// return false if it doesn't fit into CONFIG_MAX_LENGTH
+bool ConfigStore::replace(uint16_t start, uint16_t end, bool withSeparator, const char *text)
+{
+    uint16_t textLength = strlen(text) + (withSeparator ? 1 : 0);
+    uint16_t totalLength = length();
+
+    //whitespaces following replaced part are free to use
+    uint16_t spareEnd = end;
+    while (spareEnd < totalLength && isWhitespace(EEPROM.read(spareEnd)))
+        spareEnd++;
+
+    //if text doesn't fit, move bytes following spare ones (including ending 0)
+    if (start + textLength > spareEnd)
+    {
+        uint16_t shift = start + textLength - spareEnd;
+        if (totalLength + shift > CONFIG_MAX_LENGTH)
+            return false;
+        for (uint16_t i = totalLength + 1; i-- > spareEnd;)
+            EEPROM.update(i + shift, EEPROM.read(i));
+        end = start + textLength;
+    }
+
+    //write text
+    uint16_t pos = start;
+    if (withSeparator)
+        EEPROM.update(pos++, ',');
+    while (*text)
+        EEPROM.update(pos++, *text++);
+
+    //and pad remaining bytes of replaced part
+    while (pos < end)
+        EEPROM.update(pos++, ' ');
+
+    return true;
+}
+
+//------------------------------------------
+// Remove all whitespaces (outside of strings)
+void ConfigStore::compact()
+{
+    uint16_t readPos = 0, writePos = 0;
+    bool inString = false, escape = false;
+    uint8_t c;
+
+    while (readPos < CONFIG_MAX_LENGTH && (c = EEPROM.read(readPos++)))
+    {
+        if (inString)
+        {
+            if (escape)
+                escape = false;
+            else if (c == '\\')
+                escape = true;
+            else if (c == '"')
+                inString = false;
+        }
+        else if (c == '"')
+            inString = true;
+        else if (isWhitespace(c))
+            continue;
+
+        EEPROM.update(writePos++, c);
+    }
+    EEPROM.update(writePos, 0);
+}
+
+uint16_t ConfigStore::length()
+{
+    uint16_t i = 0;
+    while (i < CONFIG_MAX_LENGTH && EEPROM.read(i))
+        i++;
+    return i;
+}
+
+void ConfigStore::save(const char *json)
+{
+    uint16_t i = 0;
+    for (; json[i] && i < CONFIG_MAX_LENGTH; i++)
+        EEPROM.update(i, json[i]);
+    EEPROM.update(i, 0);
+}
+
+void ConfigStore::printTo(Print &out)
+{
+    uint16_t configLength = length();
+    for (uint16_t i = 0; i < configLength; i++)
+        out.write(EEPROM.read(i));
+}
+
+//------------------------------------------
+// Add (or replace if id already exists) a HADevices entry
+bool ConfigStore::setDevice(const char *id, const char *deviceJson)
+{
+    uint16_t arrayInsertPos, entryStart, entryEnd;
+    bool arrayEmpty;
+
+    //second try is done after compaction
+    for (uint8_t attempt = 0; attempt < 2; attempt++)
+    {
+        if (!locateDevice(id, arrayInsertPos, arrayEmpty, entryStart, entryEnd))
+            return false;
+
+        if (entryStart != CONFIG_INVALID_POS)
+        {
+            if (replace(entryStart, entryEnd, false, deviceJson))
+                return true;
+        }
+        else if (replace(arrayInsertPos, arrayInsertPos, !arrayEmpty, deviceJson))
+            return true;
+
+        compact();
+    }
+
+    return false;
+}
+
+//------------------------------------------
+// Remove a HADevices entry (replaced by spaces with its separator)
+bool ConfigStore::removeDevice(const char *id)
+{
+    uint16_t arrayInsertPos, entryStart, entryEnd;
+    bool arrayEmpty;
+
+    if (!locateDevice(id, arrayInsertPos, arrayEmpty, entryStart, entryEnd) || entryStart == CONFIG_INVALID_POS)
+        return false;
+
+    //look for previous separator
+    uint16_t start = entryStart;
+    while (start > 0 && isWhitespace(EEPROM.read(start - 1)))
+        start--;
+    if (start > 0 && EEPROM.read(start - 1) == ',')
+        start--;
+    else
+    {
+        //first entry : remove following separator
+        start = entryStart;
+        uint16_t next = skipWhitespace(entryEnd);
+        if (next != CONFIG_INVALID_POS && EEPROM.read(next) == ',')
+            entryEnd = next + 1;
+    }
+
+    for (uint16_t i = start; i < entryEnd; i++)
+        EEPROM.update(i, ' ');
+
+    return true;
+}
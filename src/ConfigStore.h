@@ -0,0 +1,36 @@
+#ifndef ConfigStore_h
+#define ConfigStore_h
+
+#include <Arduino.h>
+#include <EEPROM.h>
+
+//Config JSON is stored as text at the beginning of EEPROM (0 terminated)
+//ConfigStore allows record level edits of HADevices entries directly in EEPROM :
+// - only bytes of the edited entry are written (EEPROM.update skips unchanged ones)
+// - a shorter entry is padded with spaces, a removed one is replaced by spaces
+// - following bytes are moved only if the entry grows and no spare space follows it
+//When text would not fit anymore, whitespaces are removed (compaction) before retrying
+
+#define CONFIG_MAX_LENGTH 1535 //config JSON need to fit in globalBuffer (with ending 0)
+#define CONFIG_INVALID_POS 0xFFFF
+
+class ConfigStore
+{
+private:
+  static uint16_t skipWhitespace(uint16_t pos);
+  static uint16_t skipString(uint16_t pos);
+  static uint16_t skipValue(uint16_t pos);
+  static bool isString(uint16_t pos, const char *str);
+  static bool locateDevice(const char *id, uint16_t &arrayInsertPos, bool &arrayEmpty, uint16_t &entryStart, uint16_t &entryEnd);
+  static bool replace(uint16_t start, uint16_t end, bool withSeparator, const char *text);
+  static void compact();
+
+public:
+  static uint16_t length();
+  static void save(const char *json);
+  static void printTo(Print &out);
+  static bool setDevice(const char *id, const char *deviceJson);
+  static bool removeDevice(const char *id);
+};
+
+#endif
@@ -0,0 +1,220 @@
+#include "DNSResolver.h"
+
+//------------------------------------------
+// Build and send DNS query (type A, class IN, recursion desired)
+bool DNSResolver::sendRequest()
+{
+    _requestId = (uint16_t)micros();
+
+    if (!_udp.beginPacket(Ethernet.dnsServerIP(), DNS_PORT))
+        return false;
+
+    //Header : ID, Flags (RD), QDCOUNT=1, ANCOUNT=0, NSCOUNT=0, ARCOUNT=0
+    uint8_t header[12] = {(uint8_t)(_requestId >> 8), (uint8_t)_requestId, 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+    _udp.write(header, sizeof(header));
+
+    //Question : hostname as a list of labels
+    const char *labelStart = _hostname;
+    while (*labelStart)
+    {
+        const char *labelEnd = strchr(labelStart, '.');
+        uint8_t labelLength = labelEnd ? (labelEnd - labelStart) : strlen(labelStart);
+        _udp.write(labelLength);
+        _udp.write((const uint8_t *)labelStart, labelLength);
+        labelStart += labelLength;
+        if (*labelStart == '.')
+            labelStart++;
+    }
+    //end of name, then QTYPE=A, QCLASS=IN
+    uint8_t question[5] = {0x00, 0x00, 0x01, 0x00, 0x01};
+    _udp.write(question, sizeof(question));
+
+    _requestMillis = millis();
+
+    return _udp.endPacket();
+}
+
+//------------------------------------------
+// Skip a (possibly compressed) name in the received packet
+bool DNSResolver::skipName()
+{
+    int labelLength;
+    while ((labelLength = _udp.read()) > 0)
+    {
+        //compression pointer is 2 bytes long and ends the name
+        if ((labelLength & 0xC0) == 0xC0)
+            return _udp.read() >= 0;
+
+        while (labelLength--)
+            if (_udp.read() < 0)
+                return false;
+    }
+
+    return labelLength == 0;
+}
+
+//------------------------------------------
+// Read received packet and look for an A record
+// return false if packet is not the answer to our request
+bool DNSResolver::readAnswer()
+{
+    uint8_t header[12];
+    if (_udp.read(header, sizeof(header)) != (int)sizeof(header))
+        return false;
+
+    //check ID and that's an answer (QR bit)
+    if (header[0] != (uint8_t)(_requestId >> 8) || header[1] != (uint8_t)_requestId || !(header[2] & 0x80))
+        return false;
+
+    //then from here, this is our answer (even if resolution failed)
+    _retryLeft = 0;
+
+    //RCODE must be NoError
+    if (header[3] & 0x0F)
+        return true;
+
+    uint16_t qdCount = (header[4] << 8) | header[5];
+    uint16_t anCount = (header[6] << 8) | header[7];
+
+    //skip questions
+    while (qdCount--)
+    {
+        if (!skipName())
+            return true;
+        for (uint8_t i = 0; i < 4; i++) //QTYPE+QCLASS
+            _udp.read();
+    }
+
+    //look for the first A record in answers
+    uint8_t rr[10]; //TYPE(2)+CLASS(2)+TTL(4)+RDLENGTH(2)
+    while (anCount--)
+    {
+        if (!skipName() || _udp.read(rr, sizeof(rr)) != (int)sizeof(rr))
+            return true;
+
+        uint16_t rdLength = (rr[8] << 8) | rr[9];
+
+        //if type A, class IN and IPv4 length
+        if (rr[0] == 0x00 && rr[1] == 0x01 && rr[2] == 0x00 && rr[3] == 0x01 && rdLength == 4)
+        {
+            uint8_t addr[4];
+            if (_udp.read(addr, sizeof(addr)) != (int)sizeof(addr))
+                return true;
+
+            uint32_t ttl = ((uint32_t)rr[4] << 24) | ((uint32_t)rr[5] << 16) | ((uint32_t)rr[6] << 8) | rr[7];
+            if (ttl < DNS_MIN_TTL)
+                ttl = DNS_MIN_TTL;
+            if (ttl > DNS_MAX_TTL)
+                ttl = DNS_MAX_TTL;
+
+            _address = addr;
+            _hasAddress = true;
+            _nextResolutionMillis = millis() + ttl * 1000;
+
+            Serial.print(F("[DNSResolver] "));
+            Serial.print(_hostname);
+            Serial.print(F(" resolved to "));
+            _address.printTo(Serial);
+            Serial.print(F(" for "));
+            Serial.print(ttl);
+            Serial.println('s');
+
+            return true;
+        }
+
+        //otherwise skip data of this record (CNAME, ...)
+        while (rdLength--)
+            _udp.read();
+    }
+
+    return true;
+}
+
+//------------------------------------------
+// Set hostname to resolve (pointer must stay valid)
+void DNSResolver::begin(const char *hostname)
+{
+    _hostname = hostname;
+    _hasAddress = false;
+    _state = Idle;
+    _udp.stop();
+
+    //if hostname is an IP, there is nothing to resolve
+    IPAddress literal;
+    _isLiteral = literal.fromString(hostname);
+    if (_isLiteral)
+    {
+        _address = literal;
+        _hasAddress = true;
+    }
+
+    //first resolution is immediate
+    _nextResolutionMillis = millis();
+}
+
+//------------------------------------------
+// Send request when cached address expires then poll for the answer
+void DNSResolver::run()
+{
+    if (_isLiteral || !_hostname || !_hostname[0])
+        return;
+
+    if (_state == Idle)
+    {
+        //if cached address is still valid, nothing to do
+        if ((long)(millis() - _nextResolutionMillis) < 0)
+            return;
+
+        if (Ethernet.linkStatus() == LinkOFF || !_udp.begin(DNS_LOCAL_PORT))
+        {
+            _nextResolutionMillis = millis() + DNS_FAILED_RETRY_DELAY;
+            return;
+        }
+
+        _retryLeft = DNS_RETRY_NUMBER;
+        sendRequest();
+        _state = WaitingAnswer;
+        return;
+    }
+
+    //WaitingAnswer : read every packet received
+    while (_retryLeft && _udp.parsePacket() > 0)
+        readAnswer();
+
+    //answer received (resolved or not)
+    if (!_retryLeft)
+    {
+        _udp.stop();
+        _state = Idle;
+        //if resolution failed, retry later (keeping stale address if any)
+        if ((long)(millis() - _nextResolutionMillis) >= 0)
+        {
+            Serial.print(F("[DNSResolver] Failed to resolve "));
+            Serial.println(_hostname);
+            _nextResolutionMillis = millis() + DNS_FAILED_RETRY_DELAY;
+        }
+        return;
+    }
+
+    //no answer yet, resend the request or give up
+    if (millis() - _requestMillis > DNS_ANSWER_TIMEOUT)
+    {
+        if (--_retryLeft)
+            sendRequest();
+    }
+}
+
+bool DNSResolver::isResolving()
+{
+    return _state == WaitingAnswer;
+}
+
+bool DNSResolver::hasAddress()
+{
+    return _hasAddress;
+}
+
+IPAddress DNSResolver::getAddress()
+{
+    return _address;
+}
@@ -0,0 +1,53 @@
+#ifndef DNSResolver_h
+#define DNSResolver_h
+
+#include <Arduino.h>
+#include <Ethernet.h>
+
+//Non-blocking DNS resolver with a single cached entry
+//Request is sent then answer is polled by run() so main loop is never blocked
+//Resolved address is kept for the TTL received from DNS server (bounded by MIN/MAX)
+//If a refresh fails, previous (stale) address is kept to not lose the broker
+
+#define DNS_PORT 53
+#define DNS_LOCAL_PORT 1053
+#define DNS_ANSWER_TIMEOUT 2000      //ms to wait for an answer
+#define DNS_RETRY_NUMBER 3           //number of requests before giving up
+#define DNS_FAILED_RETRY_DELAY 30000 //ms before retrying after a failure
+#define DNS_MIN_TTL 60               //seconds
+#define DNS_MAX_TTL 86400            //seconds
+
+class DNSResolver
+{
+private:
+  enum State
+  {
+    Idle,
+    WaitingAnswer
+  };
+
+  EthernetUDP _udp;
+  const char *_hostname = NULL;
+  IPAddress _address = (uint32_t)0;
+  bool _hasAddress = false;
+  bool _isLiteral = false; //hostname is already an IP : nothing to resolve
+
+  State _state = Idle;
+  uint16_t _requestId = 0;
+  uint8_t _retryLeft = 0;
+  unsigned long _requestMillis = 0;
+  unsigned long _nextResolutionMillis = 0;
+
+  bool sendRequest();
+  bool readAnswer();
+  bool skipName();
+
+public:
+  void begin(const char *hostname);
+  void run();
+  bool isResolving();
+  bool hasAddress();
+  IPAddress getAddress();
+};
+
+#endif
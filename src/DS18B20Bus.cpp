@@ -1,212 +1,411 @@
 #include "DS18B20Bus.h"
+#include <OneWire.h>
+#include "PinOneWire.h"
+#include "UARTOneWire.h"
 
-//-----------------------------------------------------------------------
-// DS18X20 Read ScratchPad command
-boolean DS18B20Bus::readScratchPad(byte addr[], byte data[])
-{
+//Home Assistant discovery (one sensor entity per ROMCode)
+static const char discoveryComponent[] PROGMEM = "sensor";
+static const char discoveryTemplate[] PROGMEM = "{\"name\":\"%i %s\",\"uniq_id\":\"%n_%s\",\"dev_cla\":\"temperature\",\"unit_of_meas\":\"\xC2\xB0" "C\",\"stat_t\":\"%b%i/temperatures/%s/temperature\",%d}";
 
-    boolean crcScratchPadOK = false;
+//------------------------------------------
+// Add a ROMCode found by search to the list of temperature sensors
+// return its index (0xFF if not added)
+uint8_t DS18B20Bus::addROMCode(const uint8_t romCode[])
+{
+    //if ROM received is incorrect or not a Temperature sensor THEN continue to next device
+    if ((OneWire::crc8(romCode, 7) != romCode[7]) || (romCode[0] != 0x10 && romCode[0] != 0x22 && romCode[0] != 0x28))
+        return 0xFF;
 
-    //read scratchpad (if 3 failures occurs, then return the error
-    for (byte i = 0; i < 3; i++)
+    //allocate memory (list is kept between cycles and only grows)
+    if (_nbFound == _romCodesCapacity)
     {
-        // read scratchpad of the current device
-        _oneWire.reset();
-        _oneWire.select(addr);
-        _oneWire.write(0xBE); // Read ScratchPad
-        for (byte j = 0; j < 9; j++)
-        { // read 9 bytes
-            data[j] = _oneWire.read();
-        }
-        if (_oneWire.crc8(data, 8) == data[8])
-        {
-            crcScratchPadOK = true;
-            i = 3; //end for loop
-        }
+        //make reallocation
+        byte(*newRomCodes)[8] = (byte(*)[8])realloc(_romCodes, (_romCodesCapacity + 1) * 8 * sizeof(byte));
+        //if reallocation failed, keep ROMCodes found until now
+        if (newRomCodes == NULL)
+            return 0xFF;
+        //update romCodes pointer
+        _romCodes = newRomCodes;
+        _romCodesCapacity++;
     }
 
-    return crcScratchPadOK;
+    //copy the romCode
+    for (byte i = 0; i < 8; i++)
+    {
+        _romCodes[_nbFound][i] = romCode[i];
+    }
+    return _nbFound++;
 }
 //------------------------------------------
-// DS18X20 Write ScratchPad command
-void DS18B20Bus::writeScratchPad(byte addr[], byte th, byte tl, byte cfg)
+// Add a ROMCode found by alarm search to the sensors to read in this cycle
+void DS18B20Bus::addAlarm(const uint8_t romCode[])
 {
+    //others stay in alarm and will be read at next cycle
+    if (_nbAlarms == DS18B20BUS_MAX_ALARMS)
+        return;
 
-    _oneWire.reset();
-    _oneWire.select(addr);
-    _oneWire.write(0x4E); // Write ScratchPad
-    _oneWire.write(th);   //Th 80°C
-    _oneWire.write(tl);   //Tl 0°C
-    _oneWire.write(cfg);  //Config
+    //look for it in the list (sensor plugged since last full search is added)
+    uint8_t index = 0;
+    while (index < _nbROMCodes && memcmp(_romCodes[index], romCode, 8))
+        index++;
+    if (index == _nbROMCodes)
+    {
+        _nbFound = _nbROMCodes;
+        index = addROMCode(romCode);
+        _nbROMCodes = _nbFound;
+        if (index == 0xFF)
+            return;
+    }
+
+    _alarms[_nbAlarms++] = index;
 }
 //------------------------------------------
-// DS18X20 Copy ScratchPad command
-void DS18B20Bus::copyScratchPad(byte addr[])
+// List all temperature sensors ROMCodes of the bus into _romCodes (waiting for the end of the search)
+void DS18B20Bus::searchROMCodes()
 {
+    _nbFound = 0;
+
+    _master->resetSearch();
+    while (true)
+    {
+        _master->search();
+        _master->wait();
+        if (!_master->result())
+            break;
+        addROMCode(_master->romCode());
+    }
 
-    _oneWire.reset();
-    _oneWire.select(addr);
-    _oneWire.write(0x48); //Copy ScratchPad
+    _nbROMCodes = _nbFound;
 }
 //------------------------------------------
-// Function to initialize DS18X20 sensors
-void DS18B20Bus::setupTempSensors()
+// Start a transaction with current sensor (Match ROM then command prepared in _buffer[9])
+void DS18B20Bus::sensorTransaction(uint8_t length)
 {
-    byte addr[8];
-    byte data[9];
-    boolean scratchPadReaded;
-
-    //while we find some devices
-    while (_oneWire.search(addr))
+    _buffer[0] = 0x55; // Match ROM
+    memcpy(_buffer + 1, _romCodes[sensor()], 8);
+    _master->transaction(_buffer, length);
+}
+//------------------------------------------
+// DS18X20 Start Temperature conversion of all sensors
+void DS18B20Bus::startConvertT()
+{
+    _buffer[0] = 0xCC; // Skip ROM
+    _buffer[1] = 0x44; // start conversion
+    _master->transaction(_buffer, 2);
+    _converted = true;
+}
+//------------------------------------------
+// DS18X20 Read ScratchPad command of current sensor (or end of cycle)
+void DS18B20Bus::readNextScratchPad()
+{
+    if (_index >= (_alarmCycle ? _nbAlarms : _nbROMCodes))
     {
-        //if ROM received is incorrect or not a DS1822 or DS18B20 THEN continue to next device
-        if ((_oneWire.crc8(addr, 7) != addr[7]) || (addr[0] != 0x22 && addr[0] != 0x28))
-            continue;
+        _step = Idle;
 
-        scratchPadReaded = readScratchPad(addr, data);
-        //if scratchPad read failed then continue to next 1-Wire device
-        if (!scratchPadReaded)
-            continue;
-
-        //if config is not correct
-        if (data[2] != 0x50 || data[3] != 0x00 || data[4] != 0x7F)
+        //end of cycle : last readings are added to histories
+        if (_histories && ++_historyCycles >= DS18B20BUS_HISTORY_CYCLES)
         {
+            _historyCycles = 0;
+            for (uint8_t i = 0; i < _nbHistories; i++)
+                _histories[i].addSample();
+        }
+        return;
+    }
 
-            //write ScratchPad with Th=80°C, Tl=0°C, Config 12bits resolution
-            writeScratchPad(addr, 0x50, 0x00, 0x7F);
+    _buffer[9] = 0xBE; // Read ScratchPad
+    memset(_buffer + 10, 0xFF, 9);
+    sensorTransaction(19);
+    _step = Reading;
+}
+//------------------------------------------
+// Scratchpad of current sensor received
+void DS18B20Bus::scratchPadRead()
+{
+    byte *data = _buffer + 10;
 
-            scratchPadReaded = readScratchPad(addr, data);
-            //if scratchPad read failed then continue to next 1-Wire device
-            if (!scratchPadReaded)
-                continue;
+    if (!_master->result() || OneWire::crc8(data, 8) != data[8])
+    {
+        //read again (3 try), then continue to next sensor
+        if (++_retries < DS18B20BUS_READ_RETRIES)
+        {
+            readNextScratchPad();
+            return;
+        }
+    }
+    else
+    {
+        byte *addr = _romCodes[sensor()];
+        int16_t raw = convertTemperature(addr, data);
+        publishTemperature(addr, raw);
+        updateHistory(addr, raw);
+
+        //alarm thresholds : Th=80°C, Tl=0°C or published temperature +/- deadband
+        int8_t th = 80, tl = 0;
+        if (_deadband)
+        {
+            int8_t temperature = raw >> 4; //only integer part is compared by sensor
+            th = constrain(temperature + _deadband, -55, 125);
+            tl = constrain(temperature - _deadband, -55, 125);
+        }
+        //DS18S20 has no config register
+        bool resolutionOK = (addr[0] == 0x10 || data[4] == 0x7F);
 
-            //so we finally can copy scratchpad to memory
-            copyScratchPad(addr);
+        //if config of the sensor is not correct
+        if ((int8_t)data[2] != th || (int8_t)data[3] != tl || !resolutionOK)
+        {
+            //write ScratchPad with Th, Tl, Config 12bits resolution
+            _buffer[9] = 0x4E;
+            _buffer[10] = th;
+            _buffer[11] = tl;
+            _buffer[12] = 0x7F;
+            sensorTransaction(addr[0] == 0x10 ? 12 : 13);
+            //moving thresholds are not copied in sensor EEPROM (limited write cycles)
+            _copyScratchPad = !_deadband || !resolutionOK;
+            _step = Configuring;
+            return;
         }
     }
+
+    _index++;
+    _retries = 0;
+    readNextScratchPad();
 }
 //------------------------------------------
-// DS18X20 Start Temperature conversion
-void DS18B20Bus::startConvertT()
+// DS18X20 Convert scratchpad to temperature (1/16 °C)
+int16_t DS18B20Bus::convertTemperature(byte addr[], byte data[])
 {
-    _oneWire.reset();
-    _oneWire.skip();
-    _oneWire.write(0x44); // start conversion
+    // Convert the data to actual temperature
+    // because the result is a 16 bit signed integer, it should
+    // be stored to an "int16_t" type, which is always 16 bits
+    // even when compiled on a 32 bit processor.
+    int16_t raw = (data[1] << 8) | data[0];
+    if (addr[0] == 0x10)
+    {                   //type S temp Sensor
+        raw = raw << 3; // 9 bit resolution default
+        if (data[7] == 0x10)
+        {
+            // "count remain" gives full 12 bit resolution
+            raw = (raw & 0xFFF0) + 12 - data[6];
+        }
+    }
+    else
+    {
+        byte cfg = (data[4] & 0x60);
+        // at lower res, the low bits are undefined, so let's zero them
+        if (cfg == 0x00)
+            raw = raw & ~7; // 9 bit resolution, 93.75 ms
+        else if (cfg == 0x20)
+            raw = raw & ~3; // 10 bit res, 187.5 ms
+        else if (cfg == 0x40)
+            raw = raw & ~1; // 11 bit res, 375 ms
+                            // default is 12 bit resolution, 750 ms conversion time
+    }
+    return raw;
 }
 //------------------------------------------
-// DS18X20 Read and Publish Temperatures from all sensors
-void DS18B20Bus::readAndPublishTemperatures()
+// DS18X20 Publish Temperature of a sensor
+void DS18B20Bus::publishTemperature(byte addr[], int16_t raw)
 {
-    uint8_t nbROMCode = 0;
-    byte(*romCodes)[8] = NULL;
+    //topic and payload are written directly into the event
+    EventManager::Event *event = _evtMgr->newEvent();
 
-    uint8_t romCode[8];
+    //event only keeps ROMCode in binary, the end of topic (/temperatures/{ROMCode}/temperature) is written when needed
+    strcpy(event->topic, _id);
+    memcpy(event->key, addr, 8);
+    event->suffix = writeTopicSuffix;
 
-    //list all romCodes
-    _oneWire.reset_search();
-    while (_oneWire.search(romCode))
-    {
-        //if ROM received is incorrect or not a Temperature sensor THEN continue to next device
-        if ((_oneWire.crc8(romCode, 7) != romCode[7]) || (romCode[0] != 0x10 && romCode[0] != 0x22 && romCode[0] != 0x28))
-            continue;
-
-        //allocate memory
-        if (!romCodes)
-            romCodes = (byte(*)[8])malloc(++nbROMCode * 8 * sizeof(byte));
-        else
-        {
-            //make reallocation
-            byte(*newRomCodes)[8] = (byte(*)[8])realloc(romCodes, ++nbROMCode * 8 * sizeof(byte));
-            //if reallocation is successfull
-            if (newRomCodes != NULL)
-                romCodes = newRomCodes; //update romCodes pointer
-            else
-            {
-                //otherwise reallocation failed
-                free(romCodes); //free
-                return;         //and return
-            }
-        }
+    formatSixteenths(event->payload, raw);
+
+    _evtMgr->pushEvent();
+}
+
+//------------------------------------------
+// Write the end of the topic of a sensor event
+void DS18B20Bus::writeTopicSuffix(char *out, const byte romCode[])
+{
+    strcpy_P(out, PSTR("/temperatures/"));
+    out = formatHex(out + 14, romCode, 8);
+    strcpy_P(out, PSTR("/temperature"));
+}
 
-        //copy the romCode
-        for (byte i = 0; i < 8; i++)
+//------------------------------------------
+// Keep last reading of a sensor for its history (history is created at first reading)
+void DS18B20Bus::updateHistory(byte addr[], int16_t raw)
+{
+    if (!_history)
+        return;
+
+    for (uint8_t i = 0; i < _nbHistories; i++)
+    {
+        if (_histories[i].is(addr))
         {
-            romCodes[nbROMCode - 1][i] = romCode[i];
+            _histories[i].setLast(raw);
+            return;
         }
     }
 
-    byte data[12];           //buffer that receive scratchpad
-    char romCodeA[17] = {0}; //to convert ROMCode to char*
-    //now read all temperatures
-    for (byte i = 0; i < nbROMCode; i++)
+    //if reallocation failed, this sensor has no history
+    TemperatureHistory *newHistories = (TemperatureHistory *)realloc(_histories, (_nbHistories + 1) * sizeof(TemperatureHistory));
+    if (newHistories == NULL)
+        return;
+    _histories = newHistories;
+    _histories[_nbHistories++].begin(addr, raw);
+}
+
+//------------------------------------------
+// Conversion is over : refresh list of sensors then read them
+// (with deadband, only sensors in alarm are searched and read, except every DS18B20BUS_REFRESH_CYCLES cycles)
+void DS18B20Bus::startReading()
+{
+    _alarmCycle = _deadband && _cyclesBeforeRefresh;
+    if (_alarmCycle)
+        _cyclesBeforeRefresh--;
+    else
+        _cyclesBeforeRefresh = DS18B20BUS_REFRESH_CYCLES - 1;
+
+    _step = StartSearch;
+}
+
+//index of the sensor being read
+uint8_t DS18B20Bus::sensor()
+{
+    return _alarmCycle ? _alarms[_index] : _index;
+}
+
+bool DS18B20Bus::hasWork()
+{
+    return _step != Idle;
+}
+//------------------------------------------
+// Start next bus operation (previous one is over)
+void DS18B20Bus::step()
+{
+    switch (_step)
     {
-        //if read of scratchpad (3 try inside function)
-        if (!readScratchPad(romCodes[i], data))
+    case Idle:
+        break;
+
+    case StartSearch:
+        //one ROMCode per step
+        _nbFound = 0;
+        _nbAlarms = 0;
+        _master->resetSearch();
+        _master->search(_alarmCycle);
+        _step = Searching;
+        break;
+
+    case Searching:
+        if (_master->result())
         {
-            // Convert the data to actual temperature
-            // because the result is a 16 bit signed integer, it should
-            // be stored to an "int16_t" type, which is always 16 bits
-            // even when compiled on a 32 bit processor.
-            int16_t raw = (data[1] << 8) | data[0];
-            if (romCodes[i][0] == 0x10)
-            {                   //type S temp Sensor
-                raw = raw << 3; // 9 bit resolution default
-                if (data[7] == 0x10)
-                {
-                    // "count remain" gives full 12 bit resolution
-                    raw = (raw & 0xFFF0) + 12 - data[6];
-                }
-            }
+            if (_alarmCycle)
+                addAlarm(_master->romCode());
             else
-            {
-                byte cfg = (data[4] & 0x60);
-                // at lower res, the low bits are undefined, so let's zero them
-                if (cfg == 0x00)
-                    raw = raw & ~7; // 9 bit resolution, 93.75 ms
-                else if (cfg == 0x20)
-                    raw = raw & ~3; // 10 bit res, 187.5 ms
-                else if (cfg == 0x40)
-                    raw = raw & ~1; // 11 bit res, 375 ms
-                                    // default is 12 bit resolution, 750 ms conversion time
-            }
-
-            //convert ROMCode to char*
-            sprintf_P(romCodeA, PSTR("%02x%02x%02x%02x%02x%02x%02x%02x"), romCodes[i][0], romCodes[i][1], romCodes[i][2], romCodes[i][3], romCodes[i][4], romCodes[i][5], romCodes[i][6], romCodes[i][7]);
-
-            //Send temperature through MQTT (final temperature is raw/16)
-            _evtMgr->addEvent((String(_id) + F("/temperatures/") + romCodeA + F("/temperature")).c_str(), String((float)raw / 16.0, 2).c_str());
+                addROMCode(_master->romCode());
+            _master->search(_alarmCycle);
+            break;
         }
+        if (!_alarmCycle)
+            _nbROMCodes = _nbFound;
+
+        //now read all temperatures
+        _index = 0;
+        _retries = 0;
+        readNextScratchPad();
+        break;
+
+    case Reading:
+        scratchPadRead();
+        break;
+
+    case Configuring:
+        //so we finally can copy scratchpad to memory
+        if (_copyScratchPad)
+        {
+            _buffer[9] = 0x48; //Copy ScratchPad
+            sensorTransaction(10);
+            _step = Copying;
+            break;
+        }
+        _index++;
+        _retries = 0;
+        readNextScratchPad();
+        break;
+
+    case Copying:
+        _index++;
+        _retries = 0;
+        readNextScratchPad();
+        break;
     }
-
-    //now we need to free memory of romCodes
-
-    if (romCodes)
-        free(romCodes);
 }
 
-DS18B20Bus::DS18B20Bus(JsonVariant config, EventManager *evtMgr) : _oneWire(-1)
+DS18B20Bus::DS18B20Bus(JsonVariant config, EventManager *evtMgr)
 {
     if (config["id"].isNull())
         return;
 
-    if (config["pin"].isNull())
+    if (config["pin"].isNull() && config["serial"].isNull())
         return;
 
     //call Init
-    init(config["id"].as<const char *>(), config["pin"].as<uint8_t>(), evtMgr);
+    init(config["id"].as<const char *>(), config["pin"] | (uint8_t)0xFF, config["serial"] | (uint8_t)0, config["deadband"] | (uint8_t)0, config["history"] | false, evtMgr);
+};
+
+DS18B20Bus::~DS18B20Bus()
+{
+    if (_initialized)
+        DS18B20Coordinator::detach(this);
+    if (_master)
+        delete _master;
+    if (_romCodes)
+        free(_romCodes);
+    if (_histories)
+        free(_histories);
 };
 
-void DS18B20Bus::init(const char *id, uint8_t pinOneWire, EventManager *evtMgr)
+void DS18B20Bus::init(const char *id, uint8_t pinOneWire, uint8_t serial, uint8_t deadband, bool history, EventManager *evtMgr)
 {
     //DEBUG
     Serial.print(F("[DS18B20Bus] Init("));
     Serial.print(id);
     Serial.print(',');
-    Serial.print(pinOneWire);
+    if (serial)
+    {
+        Serial.print(F("Serial"));
+        Serial.print(serial);
+    }
+    else
+        Serial.print(pinOneWire);
+    Serial.print(',');
+    Serial.print(deadband);
     Serial.println(')');
 
-    //Check if pin is available
-    if (!isPinAvailable(pinOneWire))
+    if (serial)
+    {
+        if (serial > UARTONEWIRE_NB_UARTS)
+        {
+            Serial.println(F("[DS18B20Bus][ERROR]Serial must be 1, 2 or 3"));
+            return;
+        }
+
+        //Check if TX and RX pins are available
+        if (!isPinAvailable(UARTOneWire::txPin(serial)) || !isPinAvailable(UARTOneWire::rxPin(serial)))
+            return;
+
+        //1-Wire time slots generated by UART
+        _master = new UARTOneWire(serial);
+    }
+    else
+    {
+        //Check if pin is available
+        if (!isPinAvailable(pinOneWire))
+            return;
+
+        //Configure OneWire
+        _master = new PinOneWire(pinOneWire);
+    }
+
+    if (!_master)
         return;
 
     //save EventManager
@@ -215,17 +414,16 @@ void DS18B20Bus::init(const char *id, uint8_t pinOneWire, EventManager *evtMgr)
     //copy id
     strcpy(_id, id);
 
-    //Configure OneWire
-    _oneWire.begin(pinOneWire);
+    _deadband = deadband;
+    _history = history;
 
-    //Initialize temperature sensors
-    setupTempSensors();
+    //List temperature sensors (sensors config is checked at each read)
+    searchROMCodes();
 
     _initialized = true;
 
-    //start convert of temperature
-    startConvertT();
-    _timer.setOnceTimeout(800);
+    //conversions are started by coordinator (with other buses)
+    DS18B20Coordinator::attach(this);
 };
 
 void DS18B20Bus::mqttSubscribe(PubSubClient &mqttClient, const char *baseTopic){};
@@ -235,24 +433,31 @@ bool DS18B20Bus::mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsig
 };
 bool DS18B20Bus::run()
 {
-    if (_timer.isTimeoutOver())
+    //bus operations are started by DS18B20Coordinator
+    return false;
+};
+
+void DS18B20Bus::printHistory(Print &out)
+{
+    //one CSV line per sensor : id,ROMCode,temperatures (oldest first)
+    for (uint8_t i = 0; i < _nbHistories; i++)
     {
-        Serial.print(F("[DS18B20Bus] "));
-        Serial.print(_id);
-        if (_convertInProgress)
-        {
-            Serial.println(F(" is publishing"));
-            _convertInProgress = false;
-            readAndPublishTemperatures();
-            _timer.setOnceTimeout((uint16_t)PUBLISH_PERIOD * 1000 - 800);
-        }
-        else
-        {
-            Serial.println(F(" is converting"));
-            _convertInProgress = true;
-            startConvertT();
-            _timer.setOnceTimeout(800);
-        }
+        out.print(_id);
+        out.print(',');
+        _histories[i].printTo(out);
+        out.print(F("\r\n"));
     }
-    return false;
+};
+
+bool DS18B20Bus::getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId)
+{
+    if (!_initialized || index >= _nbROMCodes)
+        return false;
+
+    //convert ROMCode to char*
+    formatHex(subId, _romCodes[index], 8);
+
+    component = discoveryComponent;
+    payloadTemplate = discoveryTemplate;
+    return true;
 };
\ No newline at end of file
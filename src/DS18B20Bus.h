@@ -2,38 +2,93 @@
 #define DS18B20Bus_h
 
 #include "HADevice.h"
-#include <OneWire.h>
-#include "VerySimpleTimer.h"
+#include "Formatters.h"
+#include "OneWireMaster.h"
+#include "DS18B20Coordinator.h"
+#include "TemperatureHistory.h"
 
 //A 4.7K resistor is required between VCC and the DATA pin of the 1Wire Bus
 //VCC need to be provided to sensors (3 wires connected : GND,DATA,VCC)
+//Bus is driven by a pin (OneWire library) or by a hardware UART (UARTOneWire, in background)
+//Cycles of all buses are synchronized by DS18B20Coordinator :
+//after conversion, each step (search of one ROMCode, read of one sensor) is a separate bus operation
+//With a deadband, alarm thresholds of each sensor are set around its last published temperature,
+//then conditional search (0xEC) only returns sensors whose temperature moved : only those are read
 
 //MQTT publish :
 //  /temperatures/{ROMCode}/temperature
 //    19.25
 
 #define PUBLISH_PERIOD 60 //seconds between each convert+publish
+#define DS18B20BUS_CONVERT_TIME 800 //ms
+#define DS18B20BUS_READ_RETRIES 3
+#define DS18B20BUS_MAX_ALARMS 16    //sensors read per alarm cycle (others are read at next cycle)
+#define DS18B20BUS_REFRESH_CYCLES 10 //with deadband, all sensors are searched and read once every 10 cycles
+#define DS18B20BUS_HISTORY_CYCLES 5  //cycles between 2 history samples (5 min)
 
 class DS18B20Bus : public HADevice
 {
+    friend class DS18B20Coordinator;
+
   private:
-    OneWire _oneWire;
-    bool _convertInProgress = false;
-    VerySimpleTimer _timer; //used for Convertion and Publish
-
-    boolean readScratchPad(byte addr[], byte data[]);
-    void writeScratchPad(byte addr[], byte th, byte tl, byte cfg);
-    void copyScratchPad(byte addr[]);
-    void setupTempSensors(); //Set sensor to 12bits resolution
+    enum Step : uint8_t
+    {
+        Idle,
+        StartSearch,
+        Searching,
+        Reading,
+        Configuring,
+        Copying
+    };
+
+    OneWireMaster *_master = NULL;
+    DS18B20Bus *_nextBus = NULL; //next in DS18B20Coordinator list
+    Step _step = Idle;
+    bool _converted = false; //Convert T was sent during this cycle (sensors can be read)
+    uint8_t _buffer[19]; //bus transaction : match ROM (9) + command (1) + scratchpad (9)
+    uint8_t _index = 0;  //sensor being read
+    uint8_t _retries = 0;
+    uint8_t _nbROMCodes = 0;
+    uint8_t _nbFound = 0; //ROMCodes found by current search
+    uint8_t _romCodesCapacity = 0;
+    byte (*_romCodes)[8] = NULL; //ROMCodes of temperature sensors found on the bus
+    uint8_t _deadband = 0;           //°C (0 : all sensors are read at each cycle)
+    bool _alarmCycle = false;        //only sensors in alarm are read during this cycle
+    uint8_t _cyclesBeforeRefresh = 0; //alarm cycles before next full cycle
+    uint8_t _nbAlarms = 0;
+    uint8_t _alarms[DS18B20BUS_MAX_ALARMS]; //indexes of sensors in alarm
+    bool _copyScratchPad = false;
+    bool _history = false;
+    uint8_t _historyCycles = 0;
+    uint8_t _nbHistories = 0;
+    TemperatureHistory *_histories = NULL; //one per sensor read since startup
+
+    uint8_t addROMCode(const uint8_t romCode[]);
+    void addAlarm(const uint8_t romCode[]);
+    uint8_t sensor();
+
+    void searchROMCodes(); //blocking
+    void sensorTransaction(uint8_t length);
     void startConvertT();
-    void readAndPublishTemperatures();
+    void readNextScratchPad();
+    int16_t convertTemperature(byte addr[], byte data[]);
+    void publishTemperature(byte addr[], int16_t raw);
+    static void writeTopicSuffix(char *out, const byte romCode[]);
+    void updateHistory(byte addr[], int16_t raw);
+    void scratchPadRead();
+    void startReading();
+    bool hasWork();
+    void step();
 
   public:
     DS18B20Bus(JsonVariant config, EventManager *evtMgr);
-    void init(const char *id, uint8_t pinOneWire, EventManager *evtMgr);
+    ~DS18B20Bus();
+    void init(const char *id, uint8_t pinOneWire, uint8_t serial, uint8_t deadband, bool history, EventManager *evtMgr);
     void mqttSubscribe(PubSubClient &mqttClient, const char *baseTopic) override;
     bool mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsigned int length) override;
     bool run() override;
+    bool getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId) override;
+    void printHistory(Print &out) override;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "DS18B20Coordinator.h"
+#include "DS18B20Bus.h"
+
+DS18B20Bus *DS18B20Coordinator::_buses = NULL;
+DS18B20Bus *DS18B20Coordinator::_turn = NULL;
+DS18B20Coordinator::Phase DS18B20Coordinator::_phase = DS18B20Coordinator::Idle;
+WheelTimer DS18B20Coordinator::_timer;
+
+bool DS18B20Coordinator::anyBusy()
+{
+    for (DS18B20Bus *bus = _buses; bus; bus = bus->_nextBus)
+        if (bus->_master->busy())
+            return true;
+    return false;
+}
+
+void DS18B20Coordinator::attach(DS18B20Bus *bus)
+{
+    bus->_nextBus = _buses;
+    _buses = bus;
+
+    //new bus gets its first temperatures at next cycle, started now
+    if (_phase == Idle)
+        _timer.setOnceTimeout(0);
+}
+
+void DS18B20Coordinator::detach(DS18B20Bus *bus)
+{
+    for (DS18B20Bus **current = &_buses; *current; current = &(*current)->_nextBus)
+    {
+        if (*current == bus)
+        {
+            *current = bus->_nextBus;
+            break;
+        }
+    }
+
+    if (_turn == bus)
+        _turn = bus->_nextBus;
+    bus->_nextBus = NULL;
+
+    if (!_buses)
+    {
+        _phase = Idle;
+        _timer.stop();
+    }
+}
+
+void DS18B20Coordinator::run()
+{
+    switch (_phase)
+    {
+    case Idle:
+        //wait for period (and for the end of transactions of a bus removed during a cycle)
+        if (!_timer.isActive() || anyBusy())
+            return;
+        if (!_timer.isTimeoutOver())
+            return;
+
+        Serial.println(F("[DS18B20Coordinator] Converting"));
+
+        //start conversion on all buses at once
+        for (DS18B20Bus *bus = _buses; bus; bus = bus->_nextBus)
+            bus->startConvertT();
+
+        _phase = Converting;
+        _timer.setOnceTimeout(DS18B20BUS_CONVERT_TIME);
+        break;
+
+    case Converting:
+        if (!_timer.isTimeoutOver())
+            return;
+
+        Serial.println(F("[DS18B20Coordinator] Reading"));
+
+        for (DS18B20Bus *bus = _buses; bus; bus = bus->_nextBus)
+        {
+            //a bus attached during conversion or without presence pulse has nothing to read (scratchpad would be stale or 85°C)
+            if (bus->_converted && !bus->_master->busy() && bus->_master->result())
+                bus->startReading();
+            else
+            {
+                Serial.print(F("[DS18B20Coordinator] No conversion on "));
+                Serial.println(bus->getId());
+            }
+            bus->_converted = false;
+        }
+
+        _phase = Reading;
+        _turn = _buses;
+        break;
+
+    case Reading:
+    {
+        bool pending = false;
+
+        //give one step to the next bus (from _turn) that has work and isn't busy
+        DS18B20Bus *bus = _turn ? _turn : _buses;
+        for (DS18B20Bus *first = bus; bus;)
+        {
+            if (bus->hasWork())
+            {
+                pending = true;
+                if (!bus->_master->busy())
+                {
+                    bus->step();
+                    _turn = bus->_nextBus;
+                    return;
+                }
+            }
+
+            bus = bus->_nextBus ? bus->_nextBus : _buses;
+            if (bus == first)
+                break;
+        }
+
+        //every bus is waiting for its transaction
+        if (pending)
+            return;
+
+        //cycle is over
+        _phase = Idle;
+        _turn = NULL;
+        _timer.setOnceTimeout(PUBLISH_PERIOD * 1000UL - DS18B20BUS_CONVERT_TIME);
+        break;
+    }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#ifndef DS18B20Coordinator_h
+#define DS18B20Coordinator_h
+
+#include <Arduino.h>
+#include "TimerWheel.h"
+
+//Board-wide scheduler of DS18B20Bus cycles
+//All buses start their conversion in the same loop iteration (all temperatures of a cycle are taken at the same instant),
+//then search and scratchpad reads are interleaved round-robin : one bus step (one 1-Wire transaction) per loop iteration,
+//buses with a transaction running in background (UART) are skipped until it is over
+
+class DS18B20Bus;
+
+class DS18B20Coordinator
+{
+private:
+  enum Phase : uint8_t
+  {
+    Idle,
+    Converting,
+    Reading
+  };
+
+  static DS18B20Bus *_buses; //registered buses
+  static DS18B20Bus *_turn;  //next bus allowed to do a step
+  static Phase _phase;
+  static WheelTimer _timer;
+
+  static bool anyBusy();
+
+public:
+  static void attach(DS18B20Bus *bus);
+  static void detach(DS18B20Bus *bus);
+  static void run();
+};
+
+#endif
\ No newline at end of file
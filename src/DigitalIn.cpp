@@ -0,0 +1,249 @@
+#include "DigitalIn.h"
+
+//Home Assistant discovery
+static const char discoveryComponent[] PROGMEM = "binary_sensor";
+static const char discoveryTemplate[] PROGMEM = "{\"name\":\"%i\",\"uniq_id\":\"%n_%i\",\"stat_t\":\"%b%i/state\",\"pl_on\":\"open\",\"pl_off\":\"closed\",%d}";
+
+DigitalIn *DigitalIn::_inputs[DIGITALIN_NB_BANKS][8] = {{NULL}};
+uint8_t DigitalIn::_levels[DIGITALIN_NB_BANKS] = {0, 0, 0};
+
+static volatile uint8_t *const pcmskRegisters[DIGITALIN_NB_BANKS] = {&PCMSK0, &PCMSK1, &PCMSK2};
+
+//Find PCINT bank and bit of a pin
+//10 and 50->53 are not accepted (used by Ethernet HAT)
+static bool pinToPCInt(uint8_t pin, uint8_t &bank, uint8_t &bit)
+{
+    if (pin >= 11 && pin <= 13) //PB5->PB7
+    {
+        bank = 0;
+        bit = pin - 6;
+    }
+    else if (pin == 14 || pin == 15) //PJ1, PJ0 (PCINT8 is RX0)
+    {
+        bank = 1;
+        bit = 16 - pin;
+    }
+    else if (pin >= 62 && pin <= 69) //PK0->PK7
+    {
+        bank = 2;
+        bit = pin - 62;
+    }
+    else
+        return false;
+
+    return true;
+}
+
+//Current levels of the 8 pins of a bank
+uint8_t DigitalIn::readBank(uint8_t bank)
+{
+    switch (bank)
+    {
+    case 0:
+        return PINB;
+    case 1:
+        return (PINJ << 1) | (PINE & 1);
+    default:
+        return PINK;
+    }
+}
+
+void DigitalIn::pinChange(uint8_t bank)
+{
+    uint32_t now = micros();
+    uint8_t levels = readBank(bank);
+    uint8_t changed = levels ^ _levels[bank];
+    _levels[bank] = levels;
+
+    for (uint8_t bit = 0; changed; bit++, changed >>= 1)
+        if ((changed & 1) && _inputs[bank][bit])
+            _inputs[bank][bit]->pushEdge(now, levels & (1 << bit));
+}
+
+ISR(PCINT0_vect)
+{
+    DigitalIn::pinChange(0);
+}
+ISR(PCINT1_vect)
+{
+    DigitalIn::pinChange(1);
+}
+ISR(PCINT2_vect)
+{
+    DigitalIn::pinChange(2);
+}
+
+void DigitalIn::pushEdge(uint32_t time, bool level)
+{
+    uint8_t next = (_head + 1) & (DIGITALIN_RING_SIZE - 1);
+
+    //ring full : edge is lost, run() will read the pin again
+    if (next == _tail)
+    {
+        _overflow = true;
+        return;
+    }
+
+    _ring[_head].time = time;
+    _ring[_head].level = level;
+    //publish the edge only once it is completely written
+    _head = next;
+}
+
+//------------------------------------------
+// Debounce using edge timestamps
+void DigitalIn::processEdge(uint32_t time, bool level)
+{
+    _rawLevel = level;
+    _rawTime = time;
+
+    //edges during debounce time are bounces
+    if (level == _level || time - _lastChange < _debounce)
+        return;
+
+    _level = level;
+    _lastChange = time;
+    publish();
+}
+
+void DigitalIn::publish()
+{
+    //edge time converted into uptime (ms)
+    uint32_t edgeTime = millis() - (micros() - _lastChange) / 1000;
+
+    _evtMgr->addEvent((String(_id) + F("/state")).c_str(), (_level != _invert) ? "open" : "closed");
+    _evtMgr->addEvent((String(_id) + F("/time")).c_str(), String(edgeTime).c_str());
+}
+
+DigitalIn::DigitalIn(JsonVariant config, EventManager *evtMgr)
+{
+    if (config["id"].isNull())
+        return;
+
+    if (config["pin"].isNull())
+        return;
+
+    //call Init with parsed values
+    init(config["id"].as<const char *>(), config["pin"].as<uint8_t>(), config["pullup"] | true, config["invert"] | false,
+         config["debounce"] | (uint16_t)DIGITALIN_DEFAULT_DEBOUNCE, evtMgr);
+};
+
+DigitalIn::~DigitalIn()
+{
+    if (!_initialized)
+        return;
+
+    cli();
+    *pcmskRegisters[_bank] &= ~(1 << _bit);
+    _inputs[_bank][_bit] = NULL;
+    //disable bank interrupt if no more input uses it
+    if (!*pcmskRegisters[_bank])
+        PCICR &= ~(1 << _bank);
+    sei();
+};
+
+void DigitalIn::init(const char *id, uint8_t pin, bool pullup, bool invert, uint16_t debounce, EventManager *evtMgr)
+{
+    Serial.print(F("[DigitalIn] Init("));
+    Serial.print(id);
+    Serial.print(',');
+    Serial.print(pin);
+    Serial.print(',');
+    Serial.print(debounce);
+    Serial.println(')');
+
+    //only pin change interrupt pins are accepted
+    if (!pinToPCInt(pin, _bank, _bit))
+    {
+        Serial.println(F("[DigitalIn][ERROR]Pin has no pin change interrupt (11->15, 62->69)"));
+        return;
+    }
+
+    //Check if pin is available
+    if (!isPinAvailable(pin))
+        return;
+
+    //save EventManager
+    _evtMgr = evtMgr;
+
+    //copy id
+    strcpy(_id, id);
+
+    //save settings
+    _pin = pin;
+    _invert = invert;
+    _debounce = debounce * 1000UL;
+
+    pinMode(_pin, pullup ? INPUT_PULLUP : INPUT);
+
+    //initial level (published on first run)
+    _level = _rawLevel = digitalRead(_pin);
+    _lastChange = _rawTime = micros() - _debounce;
+
+    //attach to pin change interrupt
+    cli();
+    _inputs[_bank][_bit] = this;
+    _levels[_bank] = readBank(_bank);
+    *pcmskRegisters[_bank] |= (1 << _bit);
+    PCIFR = (1 << _bank);
+    PCICR |= (1 << _bank);
+    sei();
+
+    publish();
+
+    _initialized = true;
+};
+
+//DigitalIn doesn't accept command
+void DigitalIn::mqttSubscribe(PubSubClient &mqttClient, const char *baseTopic){};
+void DigitalIn::mqttUnsubscribe(PubSubClient &mqttClient, const char *baseTopic){};
+bool DigitalIn::mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsigned int length)
+{
+    return false;
+};
+
+void DigitalIn::printStateValue(Print &out)
+{
+    out.print((_level != _invert) ? F("\"open\"") : F("\"closed\""));
+};
+
+bool DigitalIn::run()
+{
+    if (!_initialized)
+        return false;
+
+    //pop captured edges
+    while (_tail != _head)
+    {
+        processEdge(_ring[_tail].time, _ring[_tail].level);
+        _tail = (_tail + 1) & (DIGITALIN_RING_SIZE - 1);
+    }
+
+    //some edges were lost : current pin level is the last one
+    if (_overflow)
+    {
+        _overflow = false;
+        processEdge(micros(), digitalRead(_pin));
+    }
+
+    //level changed during debounce time and didn't come back
+    if (_rawLevel != _level && micros() - _lastChange >= _debounce)
+    {
+        _level = _rawLevel;
+        _lastChange = _rawTime;
+        publish();
+    }
+
+    //edges are captured by interrupt, so always false is returned
+    return false;
+};
+
+bool DigitalIn::getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId)
+{
+    if (!_initialized || index)
+        return false;
+
+    component = discoveryComponent;
+    payloadTemplate = discoveryTemplate;
+    return true;
+};
\ No newline at end of file
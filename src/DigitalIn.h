@@ -0,0 +1,75 @@
+#ifndef DigitalIn_h
+#define DigitalIn_h
+
+#include "HADevice.h"
+
+//Contact input (door, window, leak or motion sensor)
+//Edges are captured by pin change interrupts (PCINT) with their micros() timestamp,
+//so debounce and edge time don't depend on main loop duration :
+// - interrupt routine pushes {time, level} into a ring dedicated to the input (single producer)
+// - run() pops edges from the ring (single consumer), no interrupt needs to be disabled
+//First edge is accepted immediately, following edges are ignored during debounce time,
+//then input level is checked again (to not miss a release during bounces)
+
+//MQTT publish :
+//  ID/state
+//    open/closed
+//  ID/time
+//    uptime (ms) when edge happened
+
+#define DIGITALIN_RING_SIZE 8 //edges (power of 2)
+#define DIGITALIN_NB_BANKS 3  //PCINT0 (10->13, 50->53), PCINT1 (14, 15), PCINT2 (62->69)
+
+#define DIGITALIN_DEFAULT_DEBOUNCE 50 //ms
+
+class DigitalIn : public HADevice
+{
+private:
+  struct Edge
+  {
+    uint32_t time; //micros()
+    bool level;
+  };
+
+  static DigitalIn *_inputs[DIGITALIN_NB_BANKS][8]; //input attached to each PCINT
+  static uint8_t _levels[DIGITALIN_NB_BANKS];       //last levels seen by interrupt
+
+  uint8_t _pin = 0xFF;
+  uint8_t _bank = 0;
+  uint8_t _bit = 0;
+  bool _invert = false;
+  uint32_t _debounce = DIGITALIN_DEFAULT_DEBOUNCE * 1000UL; //us
+
+  //ring written by interrupt only (_head) and read by run() only (_tail)
+  //(volatile so compiler keeps edge accesses in order with _head accesses)
+  volatile Edge _ring[DIGITALIN_RING_SIZE];
+  volatile uint8_t _head = 0;
+  volatile uint8_t _tail = 0;
+  volatile bool _overflow = false; //ring was full, some edges are lost
+
+  bool _level = false;       //debounced level
+  uint32_t _lastChange = 0;  //time of debounced level change (micros)
+  bool _rawLevel = false;    //level of last edge
+  uint32_t _rawTime = 0;     //time of last edge (micros)
+
+  static uint8_t readBank(uint8_t bank);
+  void pushEdge(uint32_t time, bool level);
+  void processEdge(uint32_t time, bool level);
+  void publish();
+
+protected:
+  void printStateValue(Print &out) override;
+
+public:
+  DigitalIn(JsonVariant config, EventManager *evtMgr);
+  ~DigitalIn();
+  void init(const char *id, uint8_t pin, bool pullup, bool invert, uint16_t debounce, EventManager *evtMgr);
+  void mqttSubscribe(PubSubClient &mqttClient, const char *baseTopic) override;
+  void mqttUnsubscribe(PubSubClient &mqttClient, const char *baseTopic) override;
+  bool mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsigned int length) override;
+  bool run() override;
+  bool getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId) override;
+  static void pinChange(uint8_t bank); //called by interrupt
+};
+
+#endif
\ No newline at end of file
@@ -1,9 +1,12 @@
 #include "DigitalOut.h"
 
+//Home Assistant discovery
+static const char discoveryComponent[] PROGMEM = "switch";
+static const char discoveryTemplate[] PROGMEM = "{\"name\":\"%i\",\"uniq_id\":\"%n_%i\",\"cmd_t\":\"%b%i/command\",\"stat_t\":\"%b%i/state\",\"pl_on\":\"1\",\"pl_off\":\"0\",%d}";
+
 void DigitalOut::on()
 {
-
-    digitalWrite(_pinOut, (_invertOutput ? LOW : HIGH));
+    _out.set(true);
     Serial.print(F("[DigitalOut] "));
     Serial.print(_id);
     Serial.println(F(" : ON"));
@@ -11,7 +14,7 @@ void DigitalOut::on()
 }
 void DigitalOut::off()
 {
-    digitalWrite(_pinOut, (_invertOutput ? HIGH : LOW));
+    _out.set(false);
     Serial.print(F("[DigitalOut] "));
     Serial.print(_id);
     Serial.println(F(" : OFF"));
@@ -30,6 +33,11 @@ DigitalOut::DigitalOut(JsonVariant config, EventManager *evtMgr)
     init(config["id"].as<const char *>(), config["pin"].as<uint8_t>(), config["invert"].as<bool>(), evtMgr);
 };
 
+DigitalOut::~DigitalOut()
+{
+    //output is switched off by its Actuator
+};
+
 void DigitalOut::init(const char *id, uint8_t pinOut, bool invertOutput, EventManager *evtMgr)
 {
     //DEBUG
@@ -49,15 +57,8 @@ void DigitalOut::init(const char *id, uint8_t pinOut, bool invertOutput, EventMa
     //copy id
     strcpy(_id, id);
 
-    //save pin numbers
-    _pinOut = pinOut;
-
-    //save invert output
-    _invertOutput = invertOutput;
-
     //setup output
-    pinMode(_pinOut, OUTPUT);
-    digitalWrite(_pinOut, (_invertOutput ? HIGH : LOW));
+    _out.begin(pinOut, invertOutput);
 
     _initialized = true;
 
@@ -85,20 +86,7 @@ bool DigitalOut::mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsig
         //if topic finishes by '/command'
         if (!strcmp_P(relevantPartOfTopic + strlen(relevantPartOfTopic) - 8, PSTR("/command")))
         {
-            if (length == 1)
-            {
-                switch (payload[0])
-                {
-                //0 requested
-                case '0':
-                    off();
-                    break;
-                //1 requested
-                case '1':
-                    on();
-                    break;
-                }
-            }
+            command(payload, length);
         }
 
         return true;
@@ -106,7 +94,40 @@ bool DigitalOut::mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsig
     return false;
 };
 
+void DigitalOut::command(uint8_t *payload, unsigned int length)
+{
+    if (length == 1)
+    {
+        switch (payload[0])
+        {
+        //0 requested
+        case '0':
+            off();
+            break;
+        //1 requested
+        case '1':
+            on();
+            break;
+        }
+    }
+};
+
+void DigitalOut::printStateValue(Print &out)
+{
+    out.print(_out.target() ? '1' : '0');
+};
+
 bool DigitalOut::run()
 {
     return false;
+};
+
+bool DigitalOut::getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId)
+{
+    if (!_initialized || index)
+        return false;
+
+    component = discoveryComponent;
+    payloadTemplate = discoveryTemplate;
+    return true;
 };
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define DigitalOut_h
 
 #include "HADevice.h"
+#include "ActuatorScheduler.h"
 
 //MQTT publish :
 //  ID/state
@@ -13,18 +14,23 @@
 class DigitalOut : public HADevice
 {
   private:
-    uint8_t _pinOut;
-    bool _invertOutput = false;
+    Actuator _out;
 
     void on();
     void off();
 
+  protected:
+    void printStateValue(Print &out) override;
+
   public:
     DigitalOut(JsonVariant config, EventManager *evtMgr);
+    ~DigitalOut();
     void init(const char *id, uint8_t pinOut, bool invertOutput, EventManager *evtMgr);
     void mqttSubscribe(PubSubClient &mqttClient, const char *baseTopic) override;
     bool mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsigned int length) override;
+    void command(uint8_t *payload, unsigned int length) override;
     bool run() override;
+    bool getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId) override;
 };
 
 #endif
\ No newline at end of file
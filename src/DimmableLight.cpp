@@ -0,0 +1,250 @@
+#include "DimmableLight.h"
+
+//Home Assistant discovery
+static const char discoveryComponent[] PROGMEM = "light";
+static const char discoveryTemplate[] PROGMEM = "{\"name\":\"%i\",\"uniq_id\":\"%n_%i\",\"cmd_t\":\"%b%i/command\",\"stat_t\":\"%b%i/state\",\"pl_on\":\"1\",\"pl_off\":\"0\",\"bri_cmd_t\":\"%b%i/brightness/command\",\"bri_stat_t\":\"%b%i/brightness\",%d}";
+
+void DimmableLight::setBrightness(uint8_t brightness, uint32_t transition)
+{
+    bool stateChanged = (brightness != 0) != (_brightness != 0);
+
+    if (brightness)
+        _lastBrightness = brightness;
+    _brightness = brightness;
+
+    //fade is done by Timer5 interrupt
+    PWMFader::fade(_channel, brightness, transition);
+
+    if (stateChanged)
+        _evtMgr->addEvent((String(_id) + F("/state")).c_str(), brightness ? "1" : "0");
+
+    char payload[4];
+    utoa(brightness, payload, 10);
+    _evtMgr->addEvent((String(_id) + F("/brightness")).c_str(), payload, true);
+}
+void DimmableLight::on(uint32_t transition)
+{
+    if (!_brightness)
+        setBrightness(_lastBrightness, transition);
+}
+void DimmableLight::off(uint32_t transition)
+{
+    if (_brightness)
+        setBrightness(0, transition);
+}
+void DimmableLight::toggle()
+{
+    if (_brightness)
+        off(_transition);
+    else
+        on(_transition);
+}
+
+//build complete topic (to delete[] after use)
+char *DimmableLight::buildTopic(const char *baseTopic, PGM_P suffixP)
+{
+    char *completeTopic = new char[strlen(baseTopic) + 1 + strlen(_id) + strlen_P(suffixP) + 1];
+    strcpy(completeTopic, baseTopic);
+    if (baseTopic[strlen(baseTopic) - 1] != '/')
+        strcat(completeTopic, "/");
+    strcat(completeTopic, _id);
+    strcat_P(completeTopic, suffixP);
+    return completeTopic;
+}
+
+DimmableLight::DimmableLight(JsonVariant config, EventManager *evtMgr)
+{
+    if (config["id"].isNull())
+        return;
+
+    if (config["pins"].isNull())
+        return;
+
+    if (config["pins"][0].isNull() || config["pins"][1].isNull())
+        return;
+
+    if (!config["pins"][0].as<uint8_t>() || !config["pins"][1].as<uint8_t>())
+        return;
+
+    //call Init with parsed values
+    init(config["id"].as<const char *>(), config["pins"][0].as<uint8_t>(), config["pins"][1].as<uint8_t>(), config["pushbutton"].as<bool>(), config["transition"] | (uint16_t)DIMMABLELIGHT_DEFAULT_TRANSITION, evtMgr);
+}
+
+DimmableLight::~DimmableLight()
+{
+    //release PWM channel (light is switched off immediately)
+    PWMFader::detach(_channel);
+}
+
+void DimmableLight::init(const char *id, uint8_t pinBtn, uint8_t pinLight, bool pushButtonMode, uint16_t transition, EventManager *evtMgr)
+{
+    Serial.print(F("[DimmableLight] Init("));
+    Serial.print(id);
+    Serial.print(',');
+    Serial.print(pinBtn);
+    Serial.print(',');
+    Serial.print(pinLight);
+    Serial.print(',');
+    Serial.print(transition);
+    if (pushButtonMode)
+    {
+        Serial.print(',');
+        Serial.print(F("pushButtonMode"));
+    }
+    Serial.println(')');
+
+    //Check if pins are available
+    if (!isPinAvailable(pinBtn))
+        return;
+    if (!isPinAvailable(pinLight))
+        return;
+
+    //setup PWM output
+    _channel = PWMFader::attach(pinLight);
+    if (_channel < 0)
+    {
+        Serial.println(F("[DimmableLight][ERROR]Pin has no usable hardware PWM (or too many DimmableLights)"));
+        return;
+    }
+
+    //save pointer to Eventmanager
+    _evtMgr = evtMgr;
+
+    //copy id
+    strcpy(_id, id);
+
+    //start button
+    _btn.attach(pinBtn, INPUT_PULLUP);
+    _btn.interval(25);
+
+    //save settings
+    _pushButtonMode = pushButtonMode;
+    _transition = transition;
+
+    _initialized = true;
+
+    //Initialization publish
+    _evtMgr->addEvent((String(_id) + F("/state")).c_str(), "0");
+    _evtMgr->addEvent((String(_id) + F("/brightness")).c_str(), "0");
+}
+
+void DimmableLight::mqttSubscribe(PubSubClient &mqttClient, const char *baseTopic)
+{
+    char *completeTopic = buildTopic(baseTopic, PSTR("/command"));
+    mqttClient.subscribe(completeTopic);
+    delete[] completeTopic;
+
+    completeTopic = buildTopic(baseTopic, PSTR("/brightness/command"));
+    mqttClient.subscribe(completeTopic);
+    delete[] completeTopic;
+}
+
+void DimmableLight::mqttUnsubscribe(PubSubClient &mqttClient, const char *baseTopic)
+{
+    char *completeTopic = buildTopic(baseTopic, PSTR("/command"));
+    mqttClient.unsubscribe(completeTopic);
+    delete[] completeTopic;
+
+    completeTopic = buildTopic(baseTopic, PSTR("/brightness/command"));
+    mqttClient.unsubscribe(completeTopic);
+    delete[] completeTopic;
+}
+
+bool DimmableLight::mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsigned int length)
+{
+    //if relevantPartOfTopic starts with id of this device ending with '/'
+    if (!strncmp(relevantPartOfTopic, _id, strlen(_id)) && relevantPartOfTopic[strlen(_id)] == '/')
+    {
+        //if topic is id/brightness/command
+        if (!strcmp_P(relevantPartOfTopic + strlen(_id), PSTR("/brightness/command")))
+        {
+            //Check Payload
+            if (length == 0 || length > 3)
+                return true;
+            uint16_t brightness = 0;
+            for (uint8_t i = 0; i < length; i++)
+            {
+                if (payload[i] < '0' || payload[i] > '9')
+                    return true;
+                brightness = brightness * 10 + (payload[i] - '0');
+            }
+
+            setBrightness(min(brightness, (uint16_t)255), _transition);
+        }
+        //if topic finishes by '/command'
+        else if (!strcmp_P(relevantPartOfTopic + strlen(relevantPartOfTopic) - 8, PSTR("/command")))
+        {
+            command(payload, length);
+        }
+
+        return true;
+    }
+    return false;
+}
+
+void DimmableLight::command(uint8_t *payload, unsigned int length)
+{
+    if (length == 1)
+    {
+        switch (payload[0])
+        {
+        //OFF requested
+        case '0':
+            off(_transition);
+            break;
+        //ON requested
+        case '1':
+            on(_transition);
+            break;
+        //Toggle requested
+        case 't':
+        case 'T':
+            toggle();
+            break;
+        }
+        return;
+    }
+
+    //JSON command (Home Assistant JSON schema) : {"state":"ON","brightness":128,"transition":2}
+    StaticJsonDocument<96> commandJSON;
+    if (!length || payload[0] != '{' || deserializeJson(commandJSON, payload, length))
+        return;
+
+    //transition is given in seconds
+    uint32_t transition = commandJSON[F("transition")].isNull() ? _transition : (uint32_t)(commandJSON[F("transition")].as<float>() * 1000);
+
+    if (!strcmp_P(commandJSON[F("state")] | "", PSTR("OFF")))
+        off(transition);
+    else if (!commandJSON[F("brightness")].isNull())
+        setBrightness(min(commandJSON[F("brightness")].as<uint16_t>(), (uint16_t)255), transition);
+    else if (!strcmp_P(commandJSON[F("state")] | "", PSTR("ON")))
+        on(transition);
+}
+
+void DimmableLight::printStateValue(Print &out)
+{
+    out.print(_brightness ? '1' : '0');
+}
+
+bool DimmableLight::run()
+{
+    if (!_initialized)
+        return false;
+
+    //if button state changed AND (not a pushButton OR input rose)
+    if (_btn.update() && (!_pushButtonMode || _btn.rose()))
+        toggle();
+
+    //fades are done by interrupt, so always false is returned
+    return false;
+}
+
+bool DimmableLight::getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId)
+{
+    if (!_initialized || index)
+        return false;
+
+    component = discoveryComponent;
+    payloadTemplate = discoveryTemplate;
+    return true;
+}
\ No newline at end of file
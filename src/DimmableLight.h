@@ -0,0 +1,53 @@
+#ifndef DimmableLight_h
+#define DimmableLight_h
+
+#include "HADevice.h"
+
+#include <Bounce2.h>
+#include "PWMFader.h"
+
+//MQTT publish :
+//  ID/state
+//    0,1
+//  ID/brightness
+//    0->255
+//MQTT subscribe :
+//  ID/command
+//    0,1,t,T or {"state":"ON","brightness":128,"transition":2}
+//  ID/brightness/command
+//    0->255
+
+#define DIMMABLELIGHT_DEFAULT_TRANSITION 500 //ms
+
+class DimmableLight : public HADevice
+{
+private:
+  Bounce _btn;
+  int8_t _channel = -1; //PWMFader channel
+  bool _pushButtonMode = false;
+  uint16_t _transition = DIMMABLELIGHT_DEFAULT_TRANSITION;
+  uint8_t _brightness = 0;       //requested brightness (reached at the end of the fade)
+  uint8_t _lastBrightness = 255; //brightness restored by on
+
+  void setBrightness(uint8_t brightness, uint32_t transition);
+  void on(uint32_t transition);
+  void off(uint32_t transition);
+  void toggle();
+  char *buildTopic(const char *baseTopic, PGM_P suffixP);
+
+protected:
+  void printStateValue(Print &out) override;
+
+public:
+  DimmableLight(JsonVariant config, EventManager *evtMgr);
+  ~DimmableLight();
+  void init(const char *id, uint8_t pinBtn, uint8_t pinLight, bool pushButtonMode, uint16_t transition, EventManager *evtMgr);
+  void mqttSubscribe(PubSubClient &mqttClient, const char *baseTopic) override;
+  void mqttUnsubscribe(PubSubClient &mqttClient, const char *baseTopic) override;
+  bool mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsigned int length) override;
+  void command(uint8_t *payload, unsigned int length) override;
+  bool run() override;
+  bool getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId) override;
+};
+
+#endif
\ No newline at end of file
@@ -11,14 +11,57 @@ EventManager::EventManager()
     }
 }
 
-void EventManager::addEvent(const char *topic, const char *payload)
+void EventManager::addEvent(const char *topic, const char *payload, bool replacePending)
 {
-    strncpy(_eventsList[_nextEventPos].topic, topic, sizeof(Event::topic));
-    strncpy(_eventsList[_nextEventPos].payload, payload, sizeof(Event::payload));
-    _eventsList[_nextEventPos].sent = false;
-    _eventsList[_nextEventPos].retryLeft = MAX_RETRY_NUMBER;
+    //look for a pending event of this topic to update (coalescing)
+    if (replacePending)
+    {
+        for (byte i = 0; i < NUMBER_OF_EVENTS; i++)
+        {
+            if (!_eventsList[i].sent && _eventsList[i].retryLeft && !_eventsList[i].suffix && !strncmp(_eventsList[i].topic, topic, sizeof(Event::topic)))
+            {
+                strncpy(_eventsList[i].payload, payload, sizeof(Event::payload) - 1);
+                _eventsList[i].payload[sizeof(Event::payload) - 1] = 0;
+                _eventsList[i].retryLeft = MAX_RETRY_NUMBER;
+                if (_listener)
+                    _listener(topic, payload);
+                return;
+            }
+        }
+    }
+
+    Event *event = newEvent();
+    strncpy(event->topic, topic, sizeof(Event::topic) - 1);
+    strncpy(event->payload, payload, sizeof(Event::payload) - 1);
+    pushEvent();
+}
+
+EventManager::Event *EventManager::newEvent()
+{
+    Event *event = &_eventsList[_nextEventPos];
+    //oldest event is replaced
+    event->sent = true;
+    event->suffix = NULL;
+    //strings are always terminated, even if too long
+    event->topic[sizeof(Event::topic) - 1] = 0;
+    event->payload[sizeof(Event::payload) - 1] = 0;
+    return event;
+}
+
+void EventManager::pushEvent()
+{
+    Event *event = &_eventsList[_nextEventPos];
+    event->sent = false;
+    event->retryLeft = MAX_RETRY_NUMBER;
 
     _nextEventPos = (_nextEventPos + 1) % NUMBER_OF_EVENTS;
+
+    if (_listener)
+    {
+        char topic[EVENT_MAX_TOPIC_LENGTH + 1];
+        buildTopic(event, topic);
+        _listener(topic, event->payload);
+    }
 }
 
 EventManager::Event *EventManager::available()
@@ -32,4 +75,18 @@ EventManager::Event *EventManager::available()
     }
 
     return NULL;
+}
+
+void EventManager::buildTopic(const Event *event, char *out)
+{
+    strcpy(out, event->topic);
+
+    //long topics are not kept in each event, their device writes the end of them
+    if (event->suffix)
+        event->suffix(out + strlen(out), event->key);
+}
+
+void EventManager::setListener(Listener listener)
+{
+    _listener = listener;
 }
\ No newline at end of file
@@ -7,14 +7,23 @@
 #define NUMBER_OF_EVENTS 16
 //number of retry to send event to Home Automation
 #define MAX_RETRY_NUMBER 3
+//longest complete topic : id(16)+/temperatures/+ROMCode(16)+/temperature (DS18B20Bus)
+#define EVENT_MAX_TOPIC_LENGTH (16 + 14 + 16 + 12)
 
 class EventManager
 {
 public:
+  //function called for each new event (local reactions, without MQTT)
+  typedef void (*Listener)(const char *topic, const char *payload);
+  //function writing the end of the topic of an event from its binary key
+  typedef void (*TopicSuffix)(char *out, const byte key[]);
+
   typedef struct
   {
-    char topic[16 + 1 + 5 + 1]; //id(16)+/+state(longest topic for now)+0
-    char payload[7];            //-10.25 (longest payload for now) (°C)
+    char topic[16 + 1 + 10 + 1]; //id(16)+/+brightness(longest topic for now)+0 (beginning of topic if suffix is set)
+    byte key[8];                 //binary part of topic (ROMCode of a DS18B20 sensor)
+    TopicSuffix suffix;          //writes the end of topic from key (NULL : topic is complete)
+    char payload[10 + 1];        //4294967295 (longest payload for now) (Wh)
     bool sent;                  //event sent to HA or not
     byte retryLeft;             //number of retries left to send event to Home Automation
   } Event;
@@ -22,11 +31,18 @@ public:
 private:
   Event _eventsList[NUMBER_OF_EVENTS]; //events list
   byte _nextEventPos = 0;
+  Listener _listener = NULL;
 
 public:
   EventManager();
-  void addEvent(const char *topic, const char *payload);
+  //if replacePending, a not yet sent event of the same topic is updated instead of adding a new one
+  void addEvent(const char *topic, const char *payload, bool replacePending = false);
+  //build an event in place (without intermediate buffer) : fill topic and payload of newEvent() then call pushEvent()
+  Event *newEvent();
+  void pushEvent();
   Event *available();
+  static void buildTopic(const Event *event, char *out); //complete topic of an event (EVENT_MAX_TOPIC_LENGTH + 1 char)
+  void setListener(Listener listener);
 };
 
 #endif
\ No newline at end of file
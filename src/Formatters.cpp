@@ -0,0 +1,45 @@
+#include "Formatters.h"
+
+static const char hexDigits[] PROGMEM = "0123456789abcdef";
+
+//------------------------------------------
+// Write bytes in hexadecimal (2 char per byte + 0), return pointer to the end
+char *formatHex(char *out, const uint8_t data[], uint8_t length)
+{
+    for (uint8_t i = 0; i < length; i++)
+    {
+        *out++ = pgm_read_byte(hexDigits + (data[i] >> 4));
+        *out++ = pgm_read_byte(hexDigits + (data[i] & 0x0F));
+    }
+    *out = 0;
+    return out;
+}
+//------------------------------------------
+// Write a fixed point value (raw/16) with 2 decimals using integers only : -55.00 -> 125.00 (DS18B20 range)
+void formatSixteenths(char *out, int16_t raw)
+{
+    if (raw < 0)
+    {
+        *out++ = '-';
+        raw = -raw;
+    }
+
+    //raw x 100 / 16 = raw x 25 / 4 (rounded) : hundredths, fits in 16 bits
+    uint16_t hundredths = ((uint16_t)raw * 25 + 2) >> 2;
+    uint8_t integer = hundredths / 100;
+    uint8_t fraction = hundredths - integer * 100;
+
+    if (integer >= 100)
+    {
+        *out++ = '1';
+        integer -= 100;
+        *out++ = '0' + integer / 10;
+    }
+    else if (integer >= 10)
+        *out++ = '0' + integer / 10;
+    *out++ = '0' + integer % 10;
+    *out++ = '.';
+    *out++ = '0' + fraction / 10;
+    *out++ = '0' + fraction % 10;
+    *out = 0;
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#ifndef Formatters_h
+#define Formatters_h
+
+#include <Arduino.h>
+
+//Text formatting without printf nor float (shared by HADevices and their events)
+
+char *formatHex(char *out, const uint8_t data[], uint8_t length); //2 lowercase hexadecimal char per byte + 0, return pointer to the end
+void formatSixteenths(char *out, int16_t raw);                     //raw/16 with 2 decimals (DS18B20 temperature)
+
+#endif
\ No newline at end of file
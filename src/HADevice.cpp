@@ -1,18 +1,28 @@
 #include "HADevice.h"
+#include "PrintHelpers.h"
 
-bool HADevice::_usedPins[54] = {false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false, false};
+bool HADevice::_usedPins[HADEVICE_NB_PINS] = {false};
+
+//release pins reserved by this device so another one can use them
+HADevice::~HADevice()
+{
+    for (uint8_t i = 0; i < _nbPins; i++)
+        _usedPins[_pins[i]] = false;
+};
 
 //function used to check if a pin is available and mark it used for other checks
 bool HADevice::isPinAvailable(uint8_t pinNumber)
 {
-    if (pinNumber > 53)
+    if (pinNumber >= HADEVICE_NB_PINS)
     {
         Serial.print(F("[HADevice][ERROR]Incorrect pin number : "));
         Serial.println(pinNumber);
+        return false;
     }
-    if (!_usedPins[pinNumber])
+    if (!_usedPins[pinNumber] && _nbPins < HADEVICE_MAX_PINS)
     {
         _usedPins[pinNumber] = true;
+        _pins[_nbPins++] = pinNumber;
         return true;
     }
     else
@@ -22,4 +32,95 @@ bool HADevice::isPinAvailable(uint8_t pinNumber)
     }
 
     return false;
+};
+
+//function used to print current state of the device as a JSON value (null if device has no state)
+void HADevice::printStateValue(Print &out)
+{
+    out.print(F("null"));
+};
+
+//function used to print "id":state (JSON member) of the device, preceded by ',' if requested
+//return false (and print nothing) if device is not initialized
+bool HADevice::printState(Print &out, bool withSeparator)
+{
+    if (!_initialized)
+        return false;
+
+    if (withSeparator)
+        out.print(',');
+    out.print('"');
+    out.print(_id);
+    out.print(F("\":"));
+    printStateValue(out);
+
+    return true;
+};
+
+//function used to compare current state of the device to a value (false if device is not initialized)
+bool HADevice::isState(const char *value)
+{
+    if (!_initialized)
+        return false;
+
+    PrintCompare compare(value);
+    printStateValue(compare);
+    return compare.equals();
+};
+
+//by default, a device doesn't accept command
+void HADevice::command(uint8_t *payload, unsigned int length){};
+
+//by default, a device has no Home Assistant entity
+bool HADevice::getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId)
+{
+    return false;
+};
+
+//by default, a device keeps no history
+void HADevice::printHistory(Print &out){};
+
+//by default, a device doesn't react to events of other devices
+void HADevice::onEvent(const char *topic, const char *payload){};
+
+//by default, a device doesn't use other devices
+void HADevice::resolve(HADevice **haDevices, uint8_t nbHADevices){};
+
+//by default, a device is not a PilotWire
+PilotWire *HADevice::asPilotWire()
+{
+    return NULL;
+};
+
+const char *HADevice::getId()
+{
+    return _id;
+};
+
+//by default, a device is subscribed to id/command only
+void HADevice::mqttUnsubscribe(PubSubClient &mqttClient, const char *baseTopic)
+{
+    char *completeTopic = new char[strlen(baseTopic) + 1 + strlen(_id) + 8 + 1]; // /command
+    strcpy(completeTopic, baseTopic);
+    if (baseTopic[strlen(baseTopic) - 1] != '/')
+        strcat(completeTopic, "/");
+    strcat(completeTopic, _id);
+    strcat_P(completeTopic, PSTR("/command"));
+    mqttClient.unsubscribe(completeTopic);
+    delete[] completeTopic;
+};
+
+bool HADevice::isInitialized()
+{
+    return _initialized;
+};
+
+void HADevice::setConfigHash(uint16_t configHash)
+{
+    _configHash = configHash;
+};
+
+uint16_t HADevice::getConfigHash()
+{
+    return _configHash;
 };
\ No newline at end of file
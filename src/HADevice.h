@@ -6,11 +6,22 @@
 #include <PubSubClient.h>
 
 #include "EventManager.h"
+#include "HADiscovery.h"
+
+//maximum number of pins used by one HADevice
+#define HADEVICE_MAX_PINS 4
+//number of pins of the Mega (D0-D53 then A0-A15)
+#define HADEVICE_NB_PINS 70
+
+class PilotWire;
 
 class HADevice
 {
 private:
-  static bool _usedPins[54];
+  static bool _usedPins[HADEVICE_NB_PINS];
+  uint8_t _pins[HADEVICE_MAX_PINS]; //pins reserved by this device (released at destruction)
+  uint8_t _nbPins = 0;
+  uint16_t _configHash = 0; //hash of the JSON config used to create this device
 
 protected:
   bool _initialized = false;
@@ -18,11 +29,29 @@ protected:
   EventManager *_evtMgr = NULL;
 
   bool isPinAvailable(uint8_t pinNumber);
+  virtual void printStateValue(Print &out);
 
 public:
+  virtual ~HADevice();
   virtual void mqttSubscribe(PubSubClient &mqttClient, const char *baseTopic) = 0;
+  virtual void mqttUnsubscribe(PubSubClient &mqttClient, const char *baseTopic);
   virtual bool mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsigned int length) = 0;
+  virtual void command(uint8_t *payload, unsigned int length); //payload of id/command (also used by groups)
   virtual bool run() = 0;
+  bool printState(Print &out, bool withSeparator);
+  bool isState(const char *value); //compare current state to a value (as printed in snapshot)
+  //Home Assistant discovery : give component and config template (PROGMEM) of the entity at index
+  //subId (17 char buffer) is filled by devices having multiple entities
+  //return false if there is no entity at this index
+  virtual bool getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId);
+  virtual void printHistory(Print &out); //CSV lines of recorded values (nothing if device keeps no history)
+  virtual void onEvent(const char *topic, const char *payload); //event published by any HADevice (local reactions)
+  virtual void resolve(HADevice **haDevices, uint8_t nbHADevices); //link to other HADevices (called after each change of HADevices array)
+  virtual PilotWire *asPilotWire(); //NULL if this device is not a PilotWire (no RTTI on AVR)
+  const char *getId();
+  bool isInitialized();
+  void setConfigHash(uint16_t configHash);
+  uint16_t getConfigHash();
 };
 
 #endif
\ No newline at end of file
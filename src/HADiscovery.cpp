@@ -0,0 +1,42 @@
+#include "HADiscovery.h"
+
+static const char deviceTemplate[] PROGMEM = "\"dev\":{\"ids\":[\"%n\"],\"name\":\"%n\",\"mf\":\"Domochip\",\"mdl\":\"MegaMQTT\"}";
+
+void HADiscovery::expand(Print &out, PGM_P payloadTemplate, const char *baseTopic, const char *name, const char *id, const char *subId)
+{
+    char c;
+    while ((c = pgm_read_byte(payloadTemplate++)))
+    {
+        if (c != '%')
+        {
+            out.write((uint8_t)c);
+            continue;
+        }
+
+        switch (c = pgm_read_byte(payloadTemplate++))
+        {
+        case 'b':
+            out.print(baseTopic);
+            if (baseTopic[strlen(baseTopic) - 1] != '/')
+                out.print('/');
+            break;
+        case 'n':
+            out.print(name);
+            break;
+        case 'i':
+            out.print(id);
+            break;
+        case 's':
+            out.print(subId);
+            break;
+        case 'd':
+            expand(out, deviceTemplate, baseTopic, name, id, subId);
+            break;
+        case 0: //template ends with a single %
+            return;
+        default: //%% or unknown placeholder
+            out.write((uint8_t)c);
+            break;
+        }
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef HADiscovery_h
+#define HADiscovery_h
+
+#include <Arduino.h>
+
+//Home Assistant MQTT discovery
+//Each HADevice provides PROGMEM templates of its entities config
+//Templates are expanded while being written (to the MQTT socket) so no payload is built in RAM
+//Placeholders :
+//  %b : MQTT baseTopic (with ending '/')
+//  %n : System name
+//  %i : HADevice id
+//  %s : sub entity id (DS18B20 ROMCode, ...)
+//  %d : device description block (shared by all entities)
+//  %% : %
+
+#define HA_DISCOVERY_PREFIX "homeassistant"
+#define HA_DISCOVERY_INTERVAL 200 //ms between 2 discovery publish
+
+class HADiscovery
+{
+public:
+  static void expand(Print &out, PGM_P payloadTemplate, const char *baseTopic, const char *name, const char *id, const char *subId);
+};
+
+#endif
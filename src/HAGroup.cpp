@@ -0,0 +1,88 @@
+#include "HAGroup.h"
+#include "ActuatorScheduler.h"
+
+HAGroup::HAGroup(const char *name, JsonArray memberIds)
+{
+    Serial.print(F("[HAGroup] Init("));
+    Serial.print(name);
+    Serial.println(')');
+
+    if (strlen(name) >= sizeof(_name))
+    {
+        Serial.println(F("[HAGroup][ERROR]name too long"));
+        return;
+    }
+    strcpy(_name, name);
+
+    //measure ids to store
+    uint16_t idsLength = 0;
+    for (JsonVariant memberId : memberIds)
+    {
+        if (_nbMemberIds == HAGROUP_MAX_MEMBERS)
+            break;
+        if (!memberId.as<const char *>())
+            continue;
+        idsLength += strlen(memberId.as<const char *>()) + 1;
+        _nbMemberIds++;
+    }
+
+    if (!_nbMemberIds)
+        return;
+
+    //then copy them one after the other
+    _memberIds = new char[idsLength];
+    _members = new HADevice *[_nbMemberIds];
+
+    char *memberIdPos = _memberIds;
+    uint8_t nbCopied = 0;
+    for (JsonVariant memberId : memberIds)
+    {
+        if (nbCopied == _nbMemberIds)
+            break;
+        if (!memberId.as<const char *>())
+            continue;
+        strcpy(memberIdPos, memberId.as<const char *>());
+        memberIdPos += strlen(memberIdPos) + 1;
+        nbCopied++;
+    }
+}
+
+HAGroup::~HAGroup()
+{
+    if (_memberIds)
+        delete[] _memberIds;
+    if (_members)
+        delete[] _members;
+}
+
+void HAGroup::resolve(HADevice **haDevices, uint8_t nbHADevices)
+{
+    _nbMembers = 0;
+
+    const char *memberId = _memberIds;
+    for (uint8_t m = 0; m < _nbMemberIds; m++, memberId += strlen(memberId) + 1)
+    {
+        for (uint8_t i = 0; i < nbHADevices; i++)
+        {
+            if (haDevices[i] && haDevices[i]->isInitialized() && !strcmp(haDevices[i]->getId(), memberId))
+            {
+                _members[_nbMembers++] = haDevices[i];
+                break;
+            }
+        }
+    }
+}
+
+void HAGroup::command(uint8_t *payload, unsigned int length)
+{
+    //members requests are queued then relays transitions are applied in one pass
+    ActuatorScheduler::hold();
+    for (uint8_t i = 0; i < _nbMembers; i++)
+        _members[i]->command(payload, length);
+    ActuatorScheduler::release();
+}
+
+const char *HAGroup::getName()
+{
+    return _name;
+}
\ No newline at end of file
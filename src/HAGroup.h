@@ -0,0 +1,38 @@
+#ifndef HAGroup_h
+#define HAGroup_h
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+#include "HADevice.h"
+
+//Group of HADevices commanded by one MQTT message
+//MQTT subscribe :
+//  group/NAME/command
+//    same payload as ID/command of members
+
+#define HAGROUP_MAX_MEMBERS 32
+
+class HAGroup
+{
+private:
+  char _name[17] = {0};
+  char *_memberIds = NULL;       //ids of members (each one terminated by 0)
+  uint8_t _nbMemberIds = 0;
+  HADevice **_members = NULL;    //members index (resolved from ids)
+  uint8_t _nbMembers = 0;
+
+  HAGroup(const HAGroup &) = delete;
+  HAGroup &operator=(const HAGroup &) = delete;
+
+public:
+  HAGroup(const char *name, JsonArray memberIds);
+  ~HAGroup();
+  //rebuild members index (HADevices array changes at each config update)
+  void resolve(HADevice **haDevices, uint8_t nbHADevices);
+  //send command to all members
+  void command(uint8_t *payload, unsigned int length);
+  const char *getName();
+};
+
+#endif
\ No newline at end of file
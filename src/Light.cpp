@@ -1,25 +1,29 @@
 #include "Light.h"
 
+//Home Assistant discovery
+static const char discoveryComponent[] PROGMEM = "light";
+static const char discoveryTemplate[] PROGMEM = "{\"name\":\"%i\",\"uniq_id\":\"%n_%i\",\"cmd_t\":\"%b%i/command\",\"stat_t\":\"%b%i/state\",\"pl_on\":\"1\",\"pl_off\":\"0\",%d}";
+
 void Light::on()
 {
-    if (digitalRead(_pinLight) == (_invertOutput ? HIGH : LOW))
+    if (!_light.target())
     {
-        digitalWrite(_pinLight, (_invertOutput ? LOW : HIGH));
+        _light.set(true);
         _evtMgr->addEvent((String(_id) + F("/state")).c_str(), "1");
     }
 }
 void Light::off()
 {
-    if (digitalRead(_pinLight) == (_invertOutput ? LOW : HIGH))
+    if (_light.target())
     {
-        digitalWrite(_pinLight, (_invertOutput ? HIGH : LOW));
+        _light.set(false);
         _evtMgr->addEvent((String(_id) + F("/state")).c_str(), "0");
     }
 }
 void Light::toggle()
 {
-    digitalWrite(_pinLight, !digitalRead(_pinLight));
-    _evtMgr->addEvent((String(_id) + F("/state")).c_str(), (digitalRead(_pinLight) == (_invertOutput ? HIGH : LOW)) ? "0" : "1");
+    _light.set(!_light.target());
+    _evtMgr->addEvent((String(_id) + F("/state")).c_str(), _light.target() ? "1" : "0");
 }
 
 Light::Light(JsonVariant config, EventManager *evtMgr)
@@ -36,11 +40,21 @@ Light::Light(JsonVariant config, EventManager *evtMgr)
     if (!config["pins"][0].as<uint8_t>() || !config["pins"][1].as<uint8_t>())
         return;
 
+    //gestures : true (default timings) or object with timings
+    bool gestures = config["gestures"].is<bool>() ? config["gestures"].as<bool>() : !config["gestures"].isNull();
+
     //call Init with parsed values
-    init(config["id"].as<const char *>(), config["pins"][0].as<uint8_t>(), config["pins"][1].as<uint8_t>(), config["pushbutton"].as<bool>(), config["invert"].as<bool>(), evtMgr);
+    init(config["id"].as<const char *>(), config["pins"][0].as<uint8_t>(), config["pins"][1].as<uint8_t>(), config["pushbutton"].as<bool>(),
+         gestures, config["gestures"]["click"] | (uint16_t)BUTTONGESTURE_DEFAULT_CLICK_TIME, config["gestures"]["hold"] | (uint16_t)BUTTONGESTURE_DEFAULT_HOLD_TIME, config["gestures"]["repeat"] | (uint16_t)BUTTONGESTURE_DEFAULT_REPEAT_TIME,
+         config["invert"].as<bool>(), evtMgr);
+}
+
+Light::~Light()
+{
+    //light is switched off by its Actuator
 }
 
-void Light::init(const char *id, uint8_t pinBtn, uint8_t pinLight, bool pushButtonMode, bool invertOutput, EventManager *evtMgr)
+void Light::init(const char *id, uint8_t pinBtn, uint8_t pinLight, bool pushButtonMode, bool gestures, uint16_t clickTime, uint16_t holdTime, uint16_t repeatTime, bool invertOutput, EventManager *evtMgr)
 {
     Serial.print(F("[Light] Init("));
     Serial.print(id);
@@ -52,6 +66,11 @@ void Light::init(const char *id, uint8_t pinBtn, uint8_t pinLight, bool pushButt
     {
         Serial.print(',');
         Serial.print(F("pushButtonMode"));
+        if (gestures)
+        {
+            Serial.print(',');
+            Serial.print(F("gestures"));
+        }
     }
     Serial.println(')');
 
@@ -71,19 +90,17 @@ void Light::init(const char *id, uint8_t pinBtn, uint8_t pinLight, bool pushButt
     _btn.attach(pinBtn, INPUT_PULLUP);
     _btn.interval(25);
 
-    //save pin numbers
-    _pinLight = pinLight;
-
-    //save invert output
-    _invertOutput = invertOutput;
-
     //setup output
-    pinMode(_pinLight, OUTPUT);
-    digitalWrite(_pinLight, (_invertOutput ? HIGH : LOW));
+    _light.begin(pinLight, invertOutput);
 
     //save pushButtonMode
     _pushButtonMode = pushButtonMode;
 
+    //gestures are only recognized on pushbutton
+    _gestures = pushButtonMode && gestures;
+    if (_gestures)
+        _gesture.begin(clickTime, holdTime, repeatTime);
+
     _initialized = true;
 
     //Initialization publish
@@ -109,25 +126,7 @@ bool Light::mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsigned i
         //if topic finishes by '/command'
         if (!strcmp_P(relevantPartOfTopic + strlen(relevantPartOfTopic) - 8, PSTR("/command")))
         {
-            if (length == 1)
-            {
-                switch (payload[0])
-                {
-                //OFF requested
-                case '0':
-                    off();
-                    break;
-                //ON requested
-                case '1':
-                    on();
-                    break;
-                //Toggle requested
-                case 't':
-                case 'T':
-                    toggle();
-                    break;
-                }
-            }
+            command(payload, length);
         }
 
         return true;
@@ -135,15 +134,72 @@ bool Light::mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsigned i
     return false;
 }
 
+void Light::command(uint8_t *payload, unsigned int length)
+{
+    if (length == 1)
+    {
+        switch (payload[0])
+        {
+        //OFF requested
+        case '0':
+            off();
+            break;
+        //ON requested
+        case '1':
+            on();
+            break;
+        //Toggle requested
+        case 't':
+        case 'T':
+            toggle();
+            break;
+        }
+    }
+}
+
+void Light::printStateValue(Print &out)
+{
+    out.print(_light.target() ? '1' : '0');
+}
+
 bool Light::run()
 {
     if (!_initialized)
         return false;
 
+    bool btnChanged = _btn.update();
+
+    if (_gestures)
+    {
+        //button is wired to ground (pressed = fell)
+        ButtonGesture::Gesture gesture = _gesture.update(btnChanged && _btn.fell(), btnChanged && _btn.rose());
+
+        if (gesture != ButtonGesture::None)
+        {
+            //single click keeps its usual action
+            if (gesture == ButtonGesture::Single)
+                toggle();
+
+            //others are only published (and can be bound to local actions using Rules)
+            char payload[8];
+            strcpy_P(payload, ButtonGesture::name(gesture));
+            _evtMgr->addEvent((String(_id) + F("/gesture")).c_str(), payload);
+        }
+    }
     //if button state changed AND (not a pushButton OR input rose)
-    if (_btn.update() && (!_pushButtonMode || _btn.rose()))
+    else if (btnChanged && (!_pushButtonMode || _btn.rose()))
         toggle(); //then invert output
 
     //no time critical state, so always false is returned
     return false;
+}
+
+bool Light::getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId)
+{
+    if (!_initialized || index)
+        return false;
+
+    component = discoveryComponent;
+    payloadTemplate = discoveryTemplate;
+    return true;
 }
\ No newline at end of file
@@ -4,10 +4,14 @@
 #include "HADevice.h"
 
 #include <Bounce2.h>
+#include "ActuatorScheduler.h"
+#include "ButtonGesture.h"
 
 //MQTT publish :
 //  ID/state
 //    0,1
+//  ID/gesture (pushbutton with gestures only)
+//    single,double,triple,hold,repeat,release
 //MQTT subscribe :
 //  ID/command
 //    0,1,t,T
@@ -16,20 +20,27 @@ class Light : public HADevice
 {
 private:
   Bounce _btn;
-  uint8_t _pinLight;
+  Actuator _light;
   bool _pushButtonMode = false;
-  bool _invertOutput = false;
+  bool _gestures = false; //pushbutton gestures are recognized (single click toggles light)
+  ButtonGesture _gesture;
 
   void on();
   void off();
   void toggle();
 
+protected:
+  void printStateValue(Print &out) override;
+
 public:
   Light(JsonVariant config, EventManager *evtMgr);
-  void init(const char *id, uint8_t pinBtn, uint8_t pinLight, bool pushButtonMode, bool invertOutput, EventManager *evtMgr);
+  ~Light();
+  void init(const char *id, uint8_t pinBtn, uint8_t pinLight, bool pushButtonMode, bool gestures, uint16_t clickTime, uint16_t holdTime, uint16_t repeatTime, bool invertOutput, EventManager *evtMgr);
   void mqttSubscribe(PubSubClient &mqttClient, const char *baseTopic) override;
   bool mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsigned int length) override;
+  void command(uint8_t *payload, unsigned int length) override;
   bool run() override;
+  bool getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId) override;
 };
 
 #endif
\ No newline at end of file
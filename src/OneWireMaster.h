@@ -0,0 +1,33 @@
+#ifndef OneWireMaster_h
+#define OneWireMaster_h
+
+#include <Arduino.h>
+
+//1-Wire bus driver used by DS18B20Bus
+//Operations can run in background (interrupt driven driver) :
+//an operation is started only when busy() is false, then its result() is available once busy() becomes false
+
+class OneWireMaster
+{
+public:
+  virtual ~OneWireMaster() {}
+  //reset pulse followed by bytes exchange (write 0xFF to read a byte) : data is replaced by bytes read
+  //result() is true if a device answered to reset pulse
+  virtual void transaction(uint8_t *data, uint8_t length) = 0;
+  virtual void resetSearch() = 0;
+  //find next ROMCode (all devices or only devices in alarm)
+  //result() is true if a ROMCode was found (CRC still needs to be checked)
+  virtual void search(bool alarmOnly = false) = 0;
+  virtual const uint8_t *romCode() = 0; //ROMCode found by last search
+  virtual bool busy() = 0;
+  virtual bool result() = 0;
+
+  //wait for end of current operation (interrupts stay enabled)
+  void wait()
+  {
+    while (busy())
+      ;
+  }
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "PWMFader.h"
+
+//duty cycle of each brightness (gamma 2.2, lowest brightness stays visible)
+static const uint8_t gammaTable[256] PROGMEM = {
+    0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2,
+    3, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6,
+    6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10, 11, 11, 11, 12,
+    12, 13, 13, 13, 14, 14, 15, 15, 16, 16, 17, 17, 18, 18, 19, 19,
+    20, 20, 21, 22, 22, 23, 23, 24, 25, 25, 26, 26, 27, 28, 28, 29,
+    30, 30, 31, 32, 33, 33, 34, 35, 35, 36, 37, 38, 39, 39, 40, 41,
+    42, 43, 43, 44, 45, 46, 47, 48, 49, 49, 50, 51, 52, 53, 54, 55,
+    56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71,
+    73, 74, 75, 76, 77, 78, 79, 81, 82, 83, 84, 85, 87, 88, 89, 90,
+    91, 93, 94, 95, 97, 98, 99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+    113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+    137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+    163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+    192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+    223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255};
+
+PWMFader::Channel PWMFader::_channels[PWMFADER_MAX_CHANNELS];
+
+ISR(TIMER5_OVF_vect)
+{
+    PWMFader::tick();
+}
+
+volatile uint8_t *PWMFader::compareRegister(uint8_t pin, bool &wide)
+{
+    wide = true;
+
+    switch (digitalPinToTimer(pin))
+    {
+    case TIMER1A:
+        return (volatile uint8_t *)&OCR1A;
+    case TIMER1B:
+        return (volatile uint8_t *)&OCR1B;
+    case TIMER3A:
+        return (volatile uint8_t *)&OCR3A;
+    case TIMER3B:
+        return (volatile uint8_t *)&OCR3B;
+    case TIMER3C:
+        return (volatile uint8_t *)&OCR3C;
+    case TIMER4A:
+        return (volatile uint8_t *)&OCR4A;
+    case TIMER4B:
+        return (volatile uint8_t *)&OCR4B;
+    case TIMER4C:
+        return (volatile uint8_t *)&OCR4C;
+    case TIMER5A:
+        return (volatile uint8_t *)&OCR5A;
+    case TIMER5B:
+        return (volatile uint8_t *)&OCR5B;
+    case TIMER5C:
+        return (volatile uint8_t *)&OCR5C;
+    case TIMER2A:
+        wide = false;
+        return &OCR2A;
+    case TIMER2B:
+        wide = false;
+        return &OCR2B;
+    //Timer0 (millis) is in fast PWM mode, output is never fully off
+    default:
+        return NULL;
+    }
+}
+
+void PWMFader::writeDuty(Channel &channel)
+{
+    uint8_t duty = pgm_read_byte(gammaTable + (uint8_t)(channel.level >> 16));
+
+    //16 bits registers need to be written at once (high byte then low byte)
+    if (channel.wide)
+        *(volatile uint16_t *)channel.ocr = duty;
+    else
+        *channel.ocr = duty;
+}
+
+int8_t PWMFader::attach(uint8_t pin)
+{
+    bool wide;
+    volatile uint8_t *ocr = compareRegister(pin, wide);
+    if (!ocr)
+        return -1;
+
+    for (int8_t i = 0; i < PWMFADER_MAX_CHANNELS; i++)
+    {
+        if (_channels[i].ocr)
+            continue;
+
+        //analogWrite connects the pin to its compare unit (duty 0 keeps it off in phase correct mode)
+        pinMode(pin, OUTPUT);
+        analogWrite(pin, 1);
+
+        cli();
+        _channels[i].ocr = ocr;
+        _channels[i].wide = wide;
+        _channels[i].target = 0;
+        _channels[i].ticksLeft = 0;
+        _channels[i].level = 0;
+        _channels[i].step = 0;
+        writeDuty(_channels[i]);
+        sei();
+
+        return i;
+    }
+
+    return -1;
+}
+
+void PWMFader::detach(int8_t channel)
+{
+    if (channel < 0 || !_channels[channel].ocr)
+        return;
+
+    cli();
+    _channels[channel].ticksLeft = 0;
+    _channels[channel].level = 0;
+    writeDuty(_channels[channel]);
+    _channels[channel].ocr = NULL;
+    sei();
+}
+
+void PWMFader::fade(int8_t channel, uint8_t brightness, uint32_t duration)
+{
+    if (channel < 0 || !_channels[channel].ocr)
+        return;
+
+    uint32_t ticks = min(duration, (uint32_t)PWMFADER_MAX_DURATION) * PWMFADER_TICKS_PER_SECOND / 1000;
+
+    cli();
+    Channel &ch = _channels[channel];
+    ch.target = brightness;
+    if (!ticks)
+    {
+        //no transition : apply now
+        ch.ticksLeft = 0;
+        ch.level = (int32_t)brightness << 16;
+        writeDuty(ch);
+    }
+    else
+    {
+        //fade starts from current level (a fade in progress is redirected)
+        ch.step = (((int32_t)brightness << 16) - ch.level) / (int32_t)ticks;
+        ch.ticksLeft = ticks;
+        TIMSK5 |= _BV(TOIE5);
+    }
+    sei();
+}
+
+void PWMFader::tick()
+{
+    bool fading = false;
+
+    for (uint8_t i = 0; i < PWMFADER_MAX_CHANNELS; i++)
+    {
+        Channel &ch = _channels[i];
+        if (!ch.ticksLeft)
+            continue;
+
+        //last tick lands exactly on target
+        if (--ch.ticksLeft)
+            ch.level += ch.step;
+        else
+            ch.level = (int32_t)ch.target << 16;
+        writeDuty(ch);
+        fading |= (ch.ticksLeft != 0);
+    }
+
+    //nothing left to fade, stop interrupt
+    if (!fading)
+        TIMSK5 &= ~_BV(TOIE5);
+}
\ No newline at end of file
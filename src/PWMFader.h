@@ -0,0 +1,41 @@
+#ifndef PWMFader_h
+#define PWMFader_h
+
+#include <Arduino.h>
+
+//Fades of hardware PWM outputs (Timers 1 to 5, Timer0 is kept for millis)
+//Timers are left in the Arduino default configuration (8 bits phase correct PWM, 490Hz)
+//Fades are interpolated in Timer5 overflow interrupt (each 2.04ms), so main loop does nothing :
+// - brightness is interpolated linearly (16.16 fixed point) then converted to duty cycle using a gamma table
+// - interrupt is only enabled while a fade is in progress
+
+#define PWMFADER_MAX_CHANNELS 12
+#define PWMFADER_TICKS_PER_SECOND 490 //Timer5 overflow frequency
+#define PWMFADER_MAX_DURATION 130000  //ms (65535 ticks)
+
+class PWMFader
+{
+private:
+  struct Channel
+  {
+    volatile uint8_t *ocr; //compare register of the pin (NULL if channel is free)
+    bool wide;             //16 bits register (Timers 1,3,4,5)
+    uint8_t target;        //brightness at the end of the fade
+    uint16_t ticksLeft;    //remaining ticks of the fade
+    int32_t level;         //current brightness (16.16)
+    int32_t step;          //brightness added at each tick (16.16)
+  };
+
+  static Channel _channels[PWMFADER_MAX_CHANNELS];
+
+  static volatile uint8_t *compareRegister(uint8_t pin, bool &wide);
+  static void writeDuty(Channel &channel);
+
+public:
+  static int8_t attach(uint8_t pin); //return channel (-1 if pin has no usable hardware PWM or no channel is left)
+  static void detach(int8_t channel); //output is switched off immediately
+  static void fade(int8_t channel, uint8_t brightness, uint32_t duration);
+  static void tick();                         //called by interrupt
+};
+
+#endif
\ No newline at end of file
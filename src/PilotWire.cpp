@@ -1,32 +1,44 @@
 #include "PilotWire.h"
 
+//Home Assistant discovery
+static const char discoveryComponent[] PROGMEM = "number";
+static const char discoveryTemplate[] PROGMEM = "{\"name\":\"%i\",\"uniq_id\":\"%n_%i\",\"ic\":\"mdi:radiator\",\"cmd_t\":\"%b%i/command\",\"stat_t\":\"%b%i/state\",\"min\":0,\"max\":99,%d}";
+
+void PilotWire::setEco(bool eco)
+{
+    //Full wave or nothing on PilotWire
+    _pos.set(eco);
+    _neg.set(eco);
+};
+
 void PilotWire::setOrder(uint8_t order)
 {
     _currentOrder = order;
+
+    //Confort-2 and Confort-1 pulses are driven by the board-wide scheduler
+    if (_currentOrder <= 30 || _currentOrder > 50)
+        PilotWireScheduler::detach(this);
+
     if (_currentOrder <= 10) //0-10 : Arrêt
     {
         //Positive half only
-        digitalWrite(_pinPos, (_invertOutput ? LOW : HIGH));
-        digitalWrite(_pinNeg, (_invertOutput ? HIGH : LOW));
+        _pos.set(true);
+        _neg.set(false);
     }
     else if (_currentOrder <= 20) //11-20 : Hors Gel
     {
         //Negative half only
-        digitalWrite(_pinPos, (_invertOutput ? HIGH : LOW));
-        digitalWrite(_pinNeg, (_invertOutput ? LOW : HIGH));
-    }
-    else if (_currentOrder <= 50) //21-30(31-40;41-50) : Eco (Confort-2; Confort-1)
-    {
-        //Full wave
-        digitalWrite(_pinPos, (_invertOutput ? LOW : HIGH));
-        digitalWrite(_pinNeg, (_invertOutput ? LOW : HIGH));
+        _pos.set(false);
+        _neg.set(true);
     }
+    else if (_currentOrder <= 30) //21-30 : Eco
+        setEco(true);
+    else if (_currentOrder <= 40) //31-40 : Confort-2
+        PilotWireScheduler::attach(this, PILOTWIRESCHEDULER_CONFORT2_PULSE);
+    else if (_currentOrder <= 50) //41-50 : Confort-1
+        PilotWireScheduler::attach(this, PILOTWIRESCHEDULER_CONFORT1_PULSE);
     else //51-99 : Confort
-    {
-        //Nothing on PilotWire
-        digitalWrite(_pinPos, (_invertOutput ? HIGH : LOW));
-        digitalWrite(_pinNeg, (_invertOutput ? HIGH : LOW));
-    }
+        setEco(false);
 
     Serial.print(F("[PilotWire] "));
     Serial.print(_id);
@@ -52,9 +64,14 @@ PilotWire::PilotWire(JsonVariant config, EventManager *evtMgr)
         return;
 
     //call Init with parsed values
-    init(config["id"].as<const char *>(), config["pins"][0].as<uint8_t>(), config["pins"][1].as<uint8_t>(), config["invert"].as<bool>(), evtMgr);
+    init(config["id"].as<const char *>(), config["pins"][0].as<uint8_t>(), config["pins"][1].as<uint8_t>(), config["invert"].as<bool>(), config["commandWindow"] | (uint16_t)PILOTWIRE_DEFAULT_COMMAND_WINDOW, evtMgr);
+};
+PilotWire::~PilotWire()
+{
+    //stop pulses, then PilotWire is released (nothing on it = Confort) by its Actuators
+    PilotWireScheduler::detach(this);
 };
-void PilotWire::init(const char *id, uint8_t pinPos, uint8_t pinNeg, bool invertOutput, EventManager *evtMgr)
+void PilotWire::init(const char *id, uint8_t pinPos, uint8_t pinNeg, bool invertOutput, uint16_t commandWindow, EventManager *evtMgr)
 {
     Serial.print(F("[PilotWire] Init("));
     Serial.print(id);
@@ -76,18 +93,12 @@ void PilotWire::init(const char *id, uint8_t pinPos, uint8_t pinNeg, bool invert
     //copy id
     strcpy(_id, id);
 
-    //save pin numbers
-    _pinPos = pinPos;
-    _pinNeg = pinNeg;
+    //setup outputs
+    _pos.begin(pinPos, invertOutput);
+    _neg.begin(pinNeg, invertOutput);
 
-    //save invert output
-    _invertOutput = invertOutput;
-
-    //setup output
-    pinMode(_pinPos, OUTPUT);
-    digitalWrite(_pinPos, (_invertOutput ? HIGH : LOW));
-    pinMode(_pinNeg, OUTPUT);
-    digitalWrite(_pinNeg, (_invertOutput ? HIGH : LOW));
+    //save MQTT command coalescing window
+    _commandWindow = commandWindow;
 
     _initialized = true;
 
@@ -113,30 +124,65 @@ bool PilotWire::mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsign
         //if topic finishes by '/command'
         if (!strcmp_P(relevantPartOfTopic + strlen(relevantPartOfTopic) - 8, PSTR("/command")))
         {
-
-            //Check Payload
-            if (length == 0)
-                return true;
-            if (length > 0 && (payload[0] < '0' || payload[0] > '9'))
-                return true;
-            if (length > 1 && (payload[1] < '0' || payload[1] > '9'))
-                return true;
-            if (length > 2)
-                return true;
-
-            //convert to number
-            uint8_t newOrder = payload[0] - '0';
-            if (length > 1)
-                newOrder = newOrder * 10 + (payload[1] - '0');
-
-            setOrder(newOrder);
+            command(payload, length);
         }
 
         return true;
     }
     return false;
 };
+
+void PilotWire::command(uint8_t *payload, unsigned int length)
+{
+    //Check Payload
+    if (length == 0)
+        return;
+    if (length > 0 && (payload[0] < '0' || payload[0] > '9'))
+        return;
+    if (length > 1 && (payload[1] < '0' || payload[1] > '9'))
+        return;
+    if (length > 2)
+        return;
+
+    //convert to number
+    uint8_t newOrder = payload[0] - '0';
+    if (length > 1)
+        newOrder = newOrder * 10 + (payload[1] - '0');
+
+    _pendingOrder = newOrder;
+
+    //without window, apply immediately
+    if (!_commandWindow)
+        setOrder(_pendingOrder);
+    //else first command of a burst opens the window, last one will be applied at its end
+    else if (!_commandTimer.isActive())
+        _commandTimer.setOnceTimeout(_commandWindow);
+};
+void PilotWire::printStateValue(Print &out)
+{
+    out.print(_currentOrder);
+};
+
 bool PilotWire::run()
 {
+    //apply last MQTT command received during commandWindow
+    if (_commandTimer.isTimeoutOver())
+        setOrder(_pendingOrder);
+
     return false;
+};
+
+bool PilotWire::getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId)
+{
+    if (!_initialized || index)
+        return false;
+
+    component = discoveryComponent;
+    payloadTemplate = discoveryTemplate;
+    return true;
+};
+
+PilotWire *PilotWire::asPilotWire()
+{
+    return this;
 };
\ No newline at end of file
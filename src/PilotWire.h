@@ -2,15 +2,17 @@
 #define PilotWire_h
 
 #include "HADevice.h"
-#include "VerySimpleTimer.h"
+#include "ActuatorScheduler.h"
+#include "TimerWheel.h"
+#include "PilotWireScheduler.h"
 
 /*
   PilotWire Orders :
   - 0-10 : Arrêt
   - 11-20 : Hors Gel
   - 21-30 : Eco
-  - 31-40 : Confort-2   //NOT YET AVAILABLE (= Eco)
-  - 41-50 : Confort-1   //NOT YET AVAILABLE (= Eco)
+  - 31-40 : Confort-2   (Confort with a 7s Eco pulse every 5 minutes, see PilotWireScheduler)
+  - 41-50 : Confort-1   (Confort with a 3s Eco pulse every 5 minutes, see PilotWireScheduler)
   - 51-99 : Confort
 */
 
@@ -21,21 +23,38 @@
 //  ID/command
 //    0->99
 
+#define PILOTWIRE_DEFAULT_COMMAND_WINDOW 150 //ms during which MQTT commands are coalesced (only last one is executed)
+
 class PilotWire : public HADevice
 {
+    friend class PilotWireScheduler;
+
   private:
     uint8_t _currentOrder = 51;
-    uint8_t _pinPos, _pinNeg;
-    bool _invertOutput = false;
+    Actuator _pos, _neg; //positive and negative half wave relays
+    uint16_t _commandWindow = 0;
+    uint8_t _pendingOrder = 0; //order received by last MQTT command (executed at end of commandWindow)
+    WheelTimer _commandTimer;
+    PilotWire *_nextHeater = NULL; //next in PilotWireScheduler list
+    uint8_t _pulseSlot = 0xFF;     //phase slot given by PilotWireScheduler
+    uint16_t _pulseLength = 0;     //ms of Eco pulse (Confort-1/Confort-2)
 
     void setOrder(uint8_t order);
+    void setEco(bool eco); //Eco (full wave) or Confort (nothing)
+
+  protected:
+    void printStateValue(Print &out) override;
 
   public:
     PilotWire(JsonVariant config, EventManager *evtMgr);
-    void init(const char *id, uint8_t pinPos, uint8_t pinNeg, bool invertOutput, EventManager *evtMgr);
+    ~PilotWire();
+    void init(const char *id, uint8_t pinPos, uint8_t pinNeg, bool invertOutput, uint16_t commandWindow, EventManager *evtMgr);
     void mqttSubscribe(PubSubClient &mqttClient, const char *baseTopic) override;
     bool mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsigned int length) override;
+    void command(uint8_t *payload, unsigned int length) override;
     bool run() override;
+    bool getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId) override;
+    PilotWire *asPilotWire() override;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "PilotWireScheduler.h"
+#include "PilotWire.h"
+
+PilotWire *PilotWireScheduler::_heaters = NULL;
+uint32_t PilotWireScheduler::_frameStart = 0;
+WheelTimer PilotWireScheduler::_timer;
+
+//lowest slot not used by another heater (shared if there are more heaters than slots)
+uint8_t PilotWireScheduler::freeSlot()
+{
+    for (uint8_t slot = 0; slot < PILOTWIRESCHEDULER_NB_SLOTS; slot++)
+    {
+        bool used = false;
+        for (PilotWire *heater = _heaters; heater && !used; heater = heater->_nextHeater)
+            used = (heater->_pulseSlot == slot);
+        if (!used)
+            return slot;
+    }
+
+    uint8_t nbHeaters = 0;
+    for (PilotWire *heater = _heaters; heater; heater = heater->_nextHeater)
+        nbHeaters++;
+    return nbHeaters % PILOTWIRESCHEDULER_NB_SLOTS;
+}
+
+void PilotWireScheduler::update()
+{
+    uint32_t now = millis();
+
+    //frame start follows time by whole periods (phases don't drift, even when millis wraps)
+    while (now - _frameStart >= PILOTWIRESCHEDULER_PERIOD)
+        _frameStart += PILOTWIRESCHEDULER_PERIOD;
+
+    uint32_t framePos = now - _frameStart;
+    uint32_t nextEdge = PILOTWIRESCHEDULER_PERIOD;
+
+    for (PilotWire *heater = _heaters; heater; heater = heater->_nextHeater)
+    {
+        //time elapsed since start of the pulse of this heater
+        uint32_t phase = (uint32_t)heater->_pulseSlot * PILOTWIRESCHEDULER_STAGGER;
+        uint32_t sincePulse = (framePos + PILOTWIRESCHEDULER_PERIOD - phase) % PILOTWIRESCHEDULER_PERIOD;
+        bool inPulse = sincePulse < heater->_pulseLength;
+
+        heater->setEco(inPulse);
+
+        uint32_t untilEdge = inPulse ? heater->_pulseLength - sincePulse : PILOTWIRESCHEDULER_PERIOD - sincePulse;
+        if (untilEdge < nextEdge)
+            nextEdge = untilEdge;
+    }
+
+    if (_heaters)
+        _timer.setOnceTimeout(nextEdge);
+    else
+        _timer.stop();
+}
+
+void PilotWireScheduler::attach(PilotWire *heater, uint16_t pulseLength)
+{
+    bool attached = false;
+    for (PilotWire *current = _heaters; current && !attached; current = current->_nextHeater)
+        attached = (current == heater);
+
+    //a heater keeps its slot when its pulse length changes
+    if (!attached)
+    {
+        if (!_heaters)
+            _frameStart = millis();
+        heater->_pulseSlot = freeSlot();
+        heater->_nextHeater = _heaters;
+        _heaters = heater;
+    }
+    heater->_pulseLength = pulseLength;
+
+    update();
+}
+
+void PilotWireScheduler::detach(PilotWire *heater)
+{
+    for (PilotWire **current = &_heaters; *current; current = &(*current)->_nextHeater)
+    {
+        if (*current == heater)
+        {
+            *current = heater->_nextHeater;
+            break;
+        }
+    }
+    heater->_nextHeater = NULL;
+    heater->_pulseSlot = 0xFF;
+
+    if (!_heaters)
+        _timer.stop();
+}
+
+void PilotWireScheduler::run()
+{
+    if (_timer.isTimeoutOver())
+        update();
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#ifndef PilotWireScheduler_h
+#define PilotWireScheduler_h
+
+#include <Arduino.h>
+#include "TimerWheel.h"
+
+//Board-wide scheduler of PilotWire Confort-1/Confort-2 waveforms
+//These orders are Confort (nothing on PilotWire) with an Eco pulse (full wave) at the start of each 5 minutes frame :
+// - Confort-1 : 3s pulse
+// - Confort-2 : 7s pulse
+//Every heater gets its own phase slot in the common frame (10s apart), so relays of different heaters never switch together
+//A single timer is armed for the next edge of all heaters : nothing is done between edges
+
+#define PILOTWIRESCHEDULER_PERIOD 300000UL //ms (5 minutes frame)
+#define PILOTWIRESCHEDULER_STAGGER 10000U  //ms between 2 phase slots (longer than the longest pulse)
+#define PILOTWIRESCHEDULER_NB_SLOTS (PILOTWIRESCHEDULER_PERIOD / PILOTWIRESCHEDULER_STAGGER)
+#define PILOTWIRESCHEDULER_CONFORT1_PULSE 3000 //ms
+#define PILOTWIRESCHEDULER_CONFORT2_PULSE 7000 //ms
+
+class PilotWire;
+
+class PilotWireScheduler
+{
+private:
+  static PilotWire *_heaters; //heaters having a pulse
+  static uint32_t _frameStart;
+  static WheelTimer _timer; //next edge of all heaters
+
+  static uint8_t freeSlot();
+  static void update(); //apply current level of every heater then arm timer for next edge
+
+public:
+  static void attach(PilotWire *heater, uint16_t pulseLength); //also used to change pulse length
+  static void detach(PilotWire *heater);
+  static void run();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include "PinOneWire.h"
+
+PinOneWire::PinOneWire(uint8_t pin) : _oneWire(pin)
+{
+}
+
+void PinOneWire::transaction(uint8_t *data, uint8_t length)
+{
+    _result = _oneWire.reset();
+    if (!_result)
+        return;
+
+    for (uint8_t i = 0; i < length; i++)
+    {
+        if (data[i] == 0xFF)
+            data[i] = _oneWire.read();
+        else
+            _oneWire.write(data[i]);
+    }
+}
+
+void PinOneWire::resetSearch()
+{
+    _oneWire.reset_search();
+}
+
+void PinOneWire::search(bool alarmOnly)
+{
+    _result = _oneWire.search(_romCode, !alarmOnly);
+}
+
+const uint8_t *PinOneWire::romCode()
+{
+    return _romCode;
+}
+
+bool PinOneWire::busy()
+{
+    return false;
+}
+
+bool PinOneWire::result()
+{
+    return _result;
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#ifndef PinOneWire_h
+#define PinOneWire_h
+
+#include "OneWireMaster.h"
+#include <OneWire.h>
+
+//1-Wire bus on any pin (bit-banged by OneWire library)
+//Operations are done immediately with interrupts disabled during each time slot
+
+class PinOneWire : public OneWireMaster
+{
+private:
+  OneWire _oneWire;
+  uint8_t _romCode[8];
+  bool _result = false;
+
+public:
+  PinOneWire(uint8_t pin);
+  void transaction(uint8_t *data, uint8_t length) override;
+  void resetSearch() override;
+  void search(bool alarmOnly = false) override;
+  const uint8_t *romCode() override;
+  bool busy() override;
+  bool result() override;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,96 @@
+#ifndef PrintHelpers_h
+#define PrintHelpers_h
+
+#include <Arduino.h>
+
+//Print that only counts bytes
+//Used to know payload length before streaming it (MQTT beginPublish, HTTP Content-Length)
+class PrintCounter : public Print
+{
+private:
+  size_t _count = 0;
+
+public:
+  size_t write(uint8_t) override
+  {
+    _count++;
+    return 1;
+  }
+  size_t write(const uint8_t *buffer, size_t size) override
+  {
+    _count += size;
+    return size;
+  }
+  size_t count() { return _count; }
+};
+
+//Print that computes a CRC16 (CCITT) of bytes written
+//Used to detect changes in a part of configuration without keeping it
+class PrintCRC16 : public Print
+{
+private:
+  uint16_t _crc = 0xFFFF;
+
+public:
+  size_t write(uint8_t b) override
+  {
+    _crc ^= (uint16_t)b << 8;
+    for (uint8_t i = 0; i < 8; i++)
+      _crc = (_crc & 0x8000) ? (_crc << 1) ^ 0x1021 : (_crc << 1);
+    return 1;
+  }
+  uint16_t crc() { return _crc; }
+};
+
+//Print that compares bytes written to a reference string
+//Used to compare a printed value without building it in a buffer
+//Quotes are skipped, so a JSON string is equal to its text
+class PrintCompare : public Print
+{
+private:
+  const char *_ref;
+  bool _equal = true;
+
+public:
+  PrintCompare(const char *ref) : _ref(ref) {}
+  size_t write(uint8_t b) override
+  {
+    if (b == '"')
+      return 1;
+    if (_equal && *_ref == (char)b)
+      _ref++;
+    else
+      _equal = false;
+    return 1;
+  }
+  bool equals() { return _equal && !*_ref; }
+};
+
+//Print that groups bytes into chunks before writing them to the final output
+//(each write to an EthernetClient is a separate SPI transfer and TCP segment)
+class PrintChunked : public Print
+{
+private:
+  Print &_out;
+  uint8_t *_buffer;
+  size_t _size;
+  size_t _pos = 0;
+
+public:
+  PrintChunked(Print &out, uint8_t *buffer, size_t size) : _out(out), _buffer(buffer), _size(size) {}
+  size_t write(uint8_t b) override
+  {
+    if (_pos == _size)
+      flush();
+    _buffer[_pos++] = b;
+    return 1;
+  }
+  void flush()
+  {
+    if (_pos)
+      _out.write(_buffer, _pos);
+    _pos = 0;
+  }
+};
+
+#endif
@@ -0,0 +1,263 @@
+#include "PulseCounter.h"
+#include "PrintHelpers.h"
+
+//Home Assistant discovery (energy and power sensors)
+static const char discoveryComponent[] PROGMEM = "sensor";
+static const char discoveryEnergyTemplate[] PROGMEM = "{\"name\":\"%i %s\",\"uniq_id\":\"%n_%i_%s\",\"dev_cla\":\"energy\",\"stat_cla\":\"total_increasing\",\"unit_of_meas\":\"Wh\",\"stat_t\":\"%b%i/%s\",%d}";
+static const char discoveryPowerTemplate[] PROGMEM = "{\"name\":\"%i %s\",\"uniq_id\":\"%n_%i_%s\",\"dev_cla\":\"power\",\"stat_cla\":\"measurement\",\"unit_of_meas\":\"W\",\"stat_t\":\"%b%i/%s\",%d}";
+
+PulseCounter *PulseCounter::_counters[PULSECOUNTER_NB_INTERRUPTS] = {NULL, NULL, NULL, NULL, NULL, NULL};
+
+//one interrupt routine per external interrupt
+template <uint8_t N>
+static void pulseISR()
+{
+    PulseCounter::pulse(N);
+}
+static void (*const pulseISRs[PULSECOUNTER_NB_INTERRUPTS])() = {pulseISR<0>, pulseISR<1>, pulseISR<2>, pulseISR<3>, pulseISR<4>, pulseISR<5>};
+
+void PulseCounter::pulse(uint8_t interrupt)
+{
+    PulseCounter *counter = _counters[interrupt];
+    if (!counter)
+        return;
+
+    uint32_t now = millis();
+    uint32_t elapsed = now - counter->_lastPulse;
+
+    //contact bounce
+    if (counter->_total && elapsed < counter->_debounce)
+        return;
+
+    counter->_interval = counter->_lastPulse ? elapsed : 0;
+    counter->_lastPulse = now;
+    counter->_total++;
+}
+
+//------------------------------------------
+// EEPROM records
+static uint8_t recordChecksum(const uint8_t *record)
+{
+    uint8_t checksum = 0xA5; //erased EEPROM (0xFF) is never a valid record
+    for (uint8_t i = 0; i < PULSECOUNTER_RECORD_SIZE - 1; i++)
+        checksum ^= record[i];
+    return checksum;
+}
+
+void PulseCounter::loadTotal()
+{
+    uint16_t areaStart = PULSECOUNTER_EEPROM_START + _interrupt * PULSECOUNTER_EEPROM_AREA_SIZE;
+    uint8_t nbRecords = PULSECOUNTER_EEPROM_AREA_SIZE / PULSECOUNTER_RECORD_SIZE;
+    uint8_t record[PULSECOUNTER_RECORD_SIZE];
+    bool found = false;
+
+    for (uint8_t i = 0; i < nbRecords; i++)
+    {
+        for (uint8_t j = 0; j < PULSECOUNTER_RECORD_SIZE; j++)
+            record[j] = EEPROM.read(areaStart + i * PULSECOUNTER_RECORD_SIZE + j);
+
+        if (record[PULSECOUNTER_RECORD_SIZE - 1] != recordChecksum(record) || (record[0] | (record[1] << 8)) != _idHash)
+            continue;
+
+        uint32_t total = (uint32_t)record[2] | ((uint32_t)record[3] << 8) | ((uint32_t)record[4] << 16) | ((uint32_t)record[5] << 24);
+        if (!found || total >= _savedTotal)
+        {
+            found = true;
+            _savedTotal = total;
+            _nextRecord = (i + 1) % nbRecords;
+        }
+    }
+
+    _total = _savedTotal;
+}
+
+void PulseCounter::saveTotal()
+{
+    cli();
+    uint32_t total = _total;
+    sei();
+
+    if (total == _savedTotal)
+        return;
+
+    uint8_t record[PULSECOUNTER_RECORD_SIZE] = {(uint8_t)_idHash, (uint8_t)(_idHash >> 8), (uint8_t)total, (uint8_t)(total >> 8), (uint8_t)(total >> 16), (uint8_t)(total >> 24), 0};
+    record[PULSECOUNTER_RECORD_SIZE - 1] = recordChecksum(record);
+
+    //each save goes to the next record of the ring (previous one stays valid if power fails during write)
+    uint16_t recordStart = PULSECOUNTER_EEPROM_START + _interrupt * PULSECOUNTER_EEPROM_AREA_SIZE + _nextRecord * PULSECOUNTER_RECORD_SIZE;
+    for (uint8_t j = 0; j < PULSECOUNTER_RECORD_SIZE; j++)
+        EEPROM.update(recordStart + j, record[j]);
+
+    _nextRecord = (_nextRecord + 1) % (PULSECOUNTER_EEPROM_AREA_SIZE / PULSECOUNTER_RECORD_SIZE);
+    _savedTotal = total;
+}
+
+//------------------------------------------
+uint32_t PulseCounter::energy()
+{
+    cli();
+    uint32_t total = _total;
+    sei();
+
+    //total * 1000 / pulsesPerKWh without overflow
+    return (total / _pulsesPerKWh) * 1000 + (total % _pulsesPerKWh) * 1000 / _pulsesPerKWh;
+}
+
+uint32_t PulseCounter::power()
+{
+    cli();
+    uint32_t lastPulse = _lastPulse;
+    uint32_t interval = _interval;
+    sei();
+
+    if (!interval)
+        return 0;
+
+    //without new pulse, power can't be higher than one pulse during elapsed time (power decreases to 0)
+    uint32_t elapsed = millis() - lastPulse;
+    if (elapsed > interval)
+        interval = elapsed;
+
+    //one pulse is 1000/pulsesPerKWh Wh
+    return (3600000000UL / _pulsesPerKWh) / interval;
+}
+
+void PulseCounter::publish()
+{
+    char payload[11];
+
+    ultoa(energy(), payload, 10);
+    _evtMgr->addEvent((String(_id) + F("/energy")).c_str(), payload, true);
+
+    ultoa(power(), payload, 10);
+    _evtMgr->addEvent((String(_id) + F("/power")).c_str(), payload, true);
+}
+
+//------------------------------------------
+PulseCounter::PulseCounter(JsonVariant config, EventManager *evtMgr)
+{
+    if (config["id"].isNull())
+        return;
+
+    if (config["pin"].isNull())
+        return;
+
+    //call Init with parsed values
+    init(config["id"].as<const char *>(), config["pin"].as<uint8_t>(),
+         config["pulsesPerKWh"] | (uint16_t)PULSECOUNTER_DEFAULT_PULSES_PER_KWH, config["debounce"] | (uint16_t)PULSECOUNTER_DEFAULT_DEBOUNCE,
+         config["publishInterval"] | (uint16_t)PULSECOUNTER_DEFAULT_PUBLISH_INTERVAL, config["saveInterval"] | (uint16_t)PULSECOUNTER_DEFAULT_SAVE_INTERVAL, evtMgr);
+};
+
+PulseCounter::~PulseCounter()
+{
+    if (!_initialized)
+        return;
+
+    //stop counting then keep last total
+    detachInterrupt(_interrupt);
+    _counters[_interrupt] = NULL;
+    saveTotal();
+};
+
+void PulseCounter::init(const char *id, uint8_t pin, uint16_t pulsesPerKWh, uint16_t debounce, uint16_t publishInterval, uint16_t saveInterval, EventManager *evtMgr)
+{
+    Serial.print(F("[PulseCounter] Init("));
+    Serial.print(id);
+    Serial.print(',');
+    Serial.print(pin);
+    Serial.print(',');
+    Serial.print(pulsesPerKWh);
+    Serial.println(')');
+
+    //only external interrupt pins are accepted
+    int8_t interrupt = digitalPinToInterrupt(pin);
+    if (interrupt < 0 || interrupt >= PULSECOUNTER_NB_INTERRUPTS)
+    {
+        Serial.println(F("[PulseCounter][ERROR]Pin is not an external interrupt pin (2, 3, 18, 19, 20, 21)"));
+        return;
+    }
+
+    if (!pulsesPerKWh)
+        return;
+
+    //Check if pin is available
+    if (!isPinAvailable(pin))
+        return;
+
+    //save EventManager
+    _evtMgr = evtMgr;
+
+    //copy id
+    strcpy(_id, id);
+
+    //save settings
+    _interrupt = interrupt;
+    _pulsesPerKWh = pulsesPerKWh;
+    _debounce = debounce;
+
+    //records in EEPROM are identified by a hash of id
+    PrintCRC16 crc;
+    crc.print(_id);
+    _idHash = crc.crc();
+
+    //restore total then start counting (S0 output pulls the line down)
+    loadTotal();
+    pinMode(pin, INPUT_PULLUP);
+    _counters[_interrupt] = this;
+    attachInterrupt(_interrupt, pulseISRs[_interrupt], FALLING);
+
+    _publishTimer.setTimeout((uint32_t)publishInterval * 1000);
+    _saveTimer.setTimeout((uint32_t)saveInterval * 1000);
+
+    _initialized = true;
+
+    //Initialization publish
+    publish();
+};
+
+//PulseCounter doesn't accept command
+void PulseCounter::mqttSubscribe(PubSubClient &mqttClient, const char *baseTopic){};
+void PulseCounter::mqttUnsubscribe(PubSubClient &mqttClient, const char *baseTopic){};
+bool PulseCounter::mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsigned int length)
+{
+    return false;
+};
+
+void PulseCounter::printStateValue(Print &out)
+{
+    out.print(energy());
+};
+
+bool PulseCounter::run()
+{
+    if (!_initialized)
+        return false;
+
+    if (_publishTimer.isTimeoutOver())
+        publish();
+
+    if (_saveTimer.isTimeoutOver())
+        saveTotal();
+
+    //pulses are counted by interrupt, so always false is returned
+    return false;
+};
+
+bool PulseCounter::getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId)
+{
+    if (!_initialized || index > 1)
+        return false;
+
+    component = discoveryComponent;
+    if (index == 0)
+    {
+        strcpy_P(subId, PSTR("energy"));
+        payloadTemplate = discoveryEnergyTemplate;
+    }
+    else
+    {
+        strcpy_P(subId, PSTR("power"));
+        payloadTemplate = discoveryPowerTemplate;
+    }
+    return true;
+};
\ No newline at end of file
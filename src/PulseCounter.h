@@ -0,0 +1,71 @@
+#ifndef PulseCounter_h
+#define PulseCounter_h
+
+#include "HADevice.h"
+
+#include <EEPROM.h>
+#include "RuleEngine.h"
+#include "TimerWheel.h"
+
+//S0 pulse counter of energy meters
+//Pulses are counted in external interrupt (INT0-5 : pins 2, 3, 18, 19, 20, 21), so no pulse is lost while main loop is busy
+//Total is saved periodically in EEPROM, in a ring of records dedicated to the interrupt (wear leveling) :
+// record = [id hash (2)][total (4)][checksum (1)], the highest total matching id hash is the last one saved
+
+//MQTT publish :
+//  ID/energy
+//    Wh
+//  ID/power
+//    W
+
+#define PULSECOUNTER_EEPROM_START (RULEENGINE_EEPROM_START + RULEENGINE_EEPROM_SIZE)
+#define PULSECOUNTER_EEPROM_AREA_SIZE 168 //per interrupt (6 areas)
+#define PULSECOUNTER_RECORD_SIZE 7
+#define PULSECOUNTER_NB_INTERRUPTS 6
+
+#define PULSECOUNTER_DEFAULT_PULSES_PER_KWH 1000
+#define PULSECOUNTER_DEFAULT_DEBOUNCE 20          //ms (S0 pulses last at least 30ms)
+#define PULSECOUNTER_DEFAULT_PUBLISH_INTERVAL 60  //s
+#define PULSECOUNTER_DEFAULT_SAVE_INTERVAL 600    //s
+
+class PulseCounter : public HADevice
+{
+private:
+  static PulseCounter *_counters[PULSECOUNTER_NB_INTERRUPTS]; //counter attached to each interrupt
+
+  uint8_t _interrupt = 0xFF;
+  uint16_t _pulsesPerKWh = PULSECOUNTER_DEFAULT_PULSES_PER_KWH;
+  uint16_t _debounce = PULSECOUNTER_DEFAULT_DEBOUNCE;
+  uint16_t _idHash = 0;
+  uint8_t _nextRecord = 0;
+  uint32_t _savedTotal = 0;
+  WheelTimer _publishTimer;
+  WheelTimer _saveTimer;
+
+  //updated by interrupt
+  volatile uint32_t _total = 0;     //pulses since first start
+  volatile uint32_t _lastPulse = 0; //ms
+  volatile uint32_t _interval = 0;  //ms between last 2 pulses (0 if unknown)
+
+  void loadTotal();
+  void saveTotal();
+  uint32_t energy(); //Wh
+  uint32_t power();  //W
+  void publish();
+
+protected:
+  void printStateValue(Print &out) override;
+
+public:
+  PulseCounter(JsonVariant config, EventManager *evtMgr);
+  ~PulseCounter();
+  void init(const char *id, uint8_t pin, uint16_t pulsesPerKWh, uint16_t debounce, uint16_t publishInterval, uint16_t saveInterval, EventManager *evtMgr);
+  void mqttSubscribe(PubSubClient &mqttClient, const char *baseTopic) override;
+  void mqttUnsubscribe(PubSubClient &mqttClient, const char *baseTopic) override;
+  bool mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsigned int length) override;
+  bool run() override;
+  bool getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId) override;
+  static void pulse(uint8_t interrupt); //called by interrupt
+};
+
+#endif
\ No newline at end of file
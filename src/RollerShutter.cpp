@@ -1,47 +1,51 @@
 #include "RollerShutter.h"
 
-void RollerShutter::goDown()
+//Home Assistant discovery
+static const char discoveryComponent[] PROGMEM = "cover";
+static const char discoveryTemplate[] PROGMEM = "{\"name\":\"%i\",\"uniq_id\":\"%n_%i\",\"dev_cla\":\"shutter\",\"cmd_t\":\"%b%i/command\",\"pl_open\":\"100\",\"pl_cls\":\"0\",\"pl_stop\":null,\"pos_t\":\"%b%i/state\",\"set_pos_t\":\"%b%i/command\",%d}";
+
+//Requests are submitted to ActuatorScheduler : movement really starts when motor is on (see run())
+void RollerShutter::goDown(uint32_t duration)
 {
     if (!_initialized)
         return;
 
     _isMoving = Down;
+    _motorRunning = false;
+    _moveDuration = duration;
 
-    if (!_veluxType) //if normal Roller Shutter
-    {
-        digitalWrite(_pinRollerDir, (_invertOutput ? HIGH : LOW));
-        _movementStart = millis();
-        digitalWrite(_pinRollerPower, (_invertOutput ? LOW : HIGH));
-    }
-    else //if Velux Roller Shutter : RollerDir=RollerUp; RollerPower=RollerDown
-    {
-        digitalWrite(_pinRollerDir, (_invertOutput ? HIGH : LOW));
-        _movementStart = millis();
-        digitalWrite(_pinRollerPower, (_invertOutput ? LOW : HIGH));
-    }
+    //For both types : RollerDir is released (Down direction or Velux RollerUp motor off), then RollerPower is switched on
+    _rollerDir.set(false);
+    _rollerPower.set(true);
 }
 
-void RollerShutter::goUp()
+void RollerShutter::goUp(uint32_t duration)
 {
     if (!_initialized)
         return;
 
     _isMoving = Up;
+    _motorRunning = false;
+    _moveDuration = duration;
 
     if (!_veluxType) //if normal Roller Shutter
     {
-        digitalWrite(_pinRollerDir, (_invertOutput ? LOW : HIGH));
-        _movementStart = millis();
-        digitalWrite(_pinRollerPower, (_invertOutput ? LOW : HIGH));
+        _rollerDir.set(true);
+        _rollerPower.set(true);
     }
     else //if Velux Roller Shutter : RollerDir=RollerUp; RollerPower=RollerDown
     {
-        digitalWrite(_pinRollerPower, (_invertOutput ? HIGH : LOW));
-        _movementStart = millis();
-        digitalWrite(_pinRollerDir, (_invertOutput ? LOW : HIGH));
+        _rollerPower.set(false);
+        _rollerDir.set(true);
     }
 }
 
+//relay that powers the motor for current movement
+Actuator &RollerShutter::motor()
+{
+    return (_veluxType && _isMoving == Up) ? _rollerDir : _rollerPower;
+}
+
 void RollerShutter::stop()
 {
     if (!_initialized)
@@ -50,42 +54,108 @@ void RollerShutter::stop()
     if (_isMoving == No)
         return;
 
-    //Stop movement
-    if (!_veluxType) //if normal Roller Shutter
-        digitalWrite(_pinRollerPower, (_invertOutput ? HIGH : LOW));
-    else //if Velux Roller Shutter : RollerDir=RollerUp; RollerPower=RollerDown
-    {
-        digitalWrite(_pinRollerPower, (_invertOutput ? HIGH : LOW));
-        digitalWrite(_pinRollerDir, (_invertOutput ? HIGH : LOW));
-    }
-
-    switch (_isMoving)
-    {
-    case Up:
-        _currentPosition += ((float)(millis() - _movementStart)) / _travelTime / 10;
-        break;
-    case Down:
-        _currentPosition -= ((float)(millis() - _movementStart)) / _travelTime / 10;
-        break;
-    case No: //never occurs
-        break;
-    }
-
-    if (_currentPosition < 0.0)
-        _currentPosition = 0.0;
-    if (_currentPosition > 100.0)
-        _currentPosition = 100.0;
+    //Stop movement (motor switch off is never delayed)
+    _rollerPower.set(false);
+    if (_veluxType) //if Velux Roller Shutter : RollerDir=RollerUp; RollerPower=RollerDown
+        _rollerDir.set(false);
 
+    _currentPosition = livePosition();
     _isMoving = No;
+    _motorRunning = false;
+    _outputTimer.stop();
+    _liveTimer.stop();
 
     Serial.print(F("[RollerShutter] "));
     Serial.print(_id);
     Serial.print(F(" is now at "));
-    Serial.print(round(_currentPosition));
+    Serial.print((_currentPosition + ROLLERSHUTTER_POSITION_SCALE / 200) / (ROLLERSHUTTER_POSITION_SCALE / 100));
     Serial.println('%');
 
     //Send new position through MQTT
-    _evtMgr->addEvent((String(_id) + F("/state")).c_str(), String(round(_currentPosition)).c_str());
+    publishPosition(_currentPosition);
+}
+
+//move to position (fixed point)
+void RollerShutter::moveTo(uint16_t position)
+{
+    //if roller is moving, then stop it (and then current Position will be refreshed)
+    if (_isMoving != No)
+        stop();
+
+    //if requested is higher than current (or fully open to resync position on end stop)
+    if (position > _currentPosition || position == ROLLERSHUTTER_POSITION_SCALE)
+    {
+        //Go Up for the right duration
+        goUp(moveDuration(position - _currentPosition, Up) + (position == ROLLERSHUTTER_POSITION_SCALE ? _overrun : 0));
+    }
+    //else if requested is lower than current (or fully closed to resync position on end stop)
+    else if (position < _currentPosition || position == 0)
+    {
+        //Go Down for the right duration
+        goDown(moveDuration(_currentPosition - position, Down) + (position == 0 ? _overrun : 0));
+    }
+
+    Serial.print(F("[RollerShutter] "));
+    Serial.print(_id);
+    Serial.print(F(" is going to "));
+    Serial.print((position + ROLLERSHUTTER_POSITION_SCALE / 200) / (ROLLERSHUTTER_POSITION_SCALE / 100));
+    Serial.println('%');
+}
+
+//start periodic publish of position during movement
+//period is the time to travel liveStep, but not shorter than liveInterval
+void RollerShutter::startLivePosition()
+{
+    //position is unknown until first full closing is done
+    if (!_ready || !_liveStep)
+        return;
+
+    uint32_t period = moveDuration(_liveStep * (ROLLERSHUTTER_POSITION_SCALE / 100), _isMoving);
+    if (period < _liveInterval)
+        period = _liveInterval;
+
+    _liveTimer.setTimeout(period);
+}
+
+//position including current movement (always computed from movement start, so no error accumulates)
+uint16_t RollerShutter::livePosition()
+{
+    if (_isMoving == No || !_motorRunning)
+        return _currentPosition;
+
+    uint16_t distance = movedDistance(millis() - _movementStart);
+
+    if (_isMoving == Up)
+        return (distance < ROLLERSHUTTER_POSITION_SCALE - _currentPosition) ? _currentPosition + distance : ROLLERSHUTTER_POSITION_SCALE;
+
+    return (distance < _currentPosition) ? _currentPosition - distance : 0;
+}
+
+//publish position (percent rounded) replacing the one not yet sent, so a moving shutter uses only one event slot
+void RollerShutter::publishPosition(uint16_t position)
+{
+    char payload[4];
+    utoa((position + ROLLERSHUTTER_POSITION_SCALE / 200) / (ROLLERSHUTTER_POSITION_SCALE / 100), payload, 10);
+    _evtMgr->addEvent((String(_id) + F("/state")).c_str(), payload, true);
+}
+
+//distance (fixed point) travelled during duration (ms) by the current movement
+uint16_t RollerShutter::movedDistance(uint32_t duration)
+{
+    uint32_t travelTime = (_isMoving == Up) ? _travelTimeUp : _travelTimeDown;
+
+    if (duration >= travelTime)
+        return ROLLERSHUTTER_POSITION_SCALE;
+
+    return duration * ROLLERSHUTTER_POSITION_SCALE / travelTime;
+}
+
+//duration (ms) required to travel distance (fixed point)
+uint32_t RollerShutter::moveDuration(uint16_t distance, Movement movement)
+{
+    uint32_t travelTime = (movement == Up) ? _travelTimeUp : _travelTimeDown;
+
+    return (travelTime * distance + ROLLERSHUTTER_POSITION_SCALE / 2) / ROLLERSHUTTER_POSITION_SCALE;
 }
 
 RollerShutter::RollerShutter(JsonVariant config, EventManager *evtMgr)
@@ -96,7 +166,12 @@ RollerShutter::RollerShutter(JsonVariant config, EventManager *evtMgr)
     if (config["pins"].isNull())
         return;
 
-    if (config["travelTime"].isNull() || config["travelTime"].as<uint8_t>() == 0)
+    //travelTime is in seconds, travelTimeUp and travelTimeDown (ms) can refine it
+    uint32_t travelTime = config["travelTime"].as<uint32_t>() * 1000;
+    uint32_t travelTimeUp = config["travelTimeUp"] | travelTime;
+    uint32_t travelTimeDown = config["travelTimeDown"] | travelTime;
+
+    if (!travelTimeUp || travelTimeUp > ROLLERSHUTTER_MAX_TRAVEL_TIME || !travelTimeDown || travelTimeDown > ROLLERSHUTTER_MAX_TRAVEL_TIME)
         return;
 
     if (config["pins"][0].isNull() || config["pins"][1].isNull() || config["pins"][2].isNull() || config["pins"][3].isNull())
@@ -106,10 +181,15 @@ RollerShutter::RollerShutter(JsonVariant config, EventManager *evtMgr)
         return;
 
     //call Init with parsed values
-    init(config["id"].as<const char *>(), config["pins"][0].as<uint8_t>(), config["pins"][1].as<uint8_t>(), config["pins"][2].as<uint8_t>(), config["pins"][3].as<uint8_t>(), config["travelTime"].as<uint8_t>(), config["invert"].as<bool>(), config["velux"].as<bool>(), evtMgr);
+    init(config["id"].as<const char *>(), config["pins"][0].as<uint8_t>(), config["pins"][1].as<uint8_t>(), config["pins"][2].as<uint8_t>(), config["pins"][3].as<uint8_t>(), travelTimeUp, travelTimeDown, config["overrun"] | (uint16_t)ROLLERSHUTTER_DEFAULT_OVERRUN, config["liveStep"] | (uint8_t)ROLLERSHUTTER_DEFAULT_LIVE_STEP, config["liveInterval"] | (uint16_t)ROLLERSHUTTER_DEFAULT_LIVE_INTERVAL, config["commandWindow"] | (uint16_t)ROLLERSHUTTER_DEFAULT_COMMAND_WINDOW, config["invert"].as<bool>(), config["velux"].as<bool>(), evtMgr);
+}
+
+RollerShutter::~RollerShutter()
+{
+    //motor is stopped by Actuators
 }
 
-void RollerShutter::init(const char *id, uint8_t pinBtnUp, uint8_t pinBtnDown, uint8_t pinRollerDir, uint8_t pinRollerPower, uint8_t travelTime, bool invertOutput, bool veluxType, EventManager *evtMgr)
+void RollerShutter::init(const char *id, uint8_t pinBtnUp, uint8_t pinBtnDown, uint8_t pinRollerDir, uint8_t pinRollerPower, uint32_t travelTimeUp, uint32_t travelTimeDown, uint16_t overrun, uint8_t liveStep, uint16_t liveInterval, uint16_t commandWindow, bool invertOutput, bool veluxType, EventManager *evtMgr)
 {
     //DEBUG
     Serial.print(F("[RollerShutter] Init("));
@@ -123,7 +203,11 @@ void RollerShutter::init(const char *id, uint8_t pinBtnUp, uint8_t pinBtnDown, u
     Serial.print(',');
     Serial.print(pinRollerPower);
     Serial.print(',');
-    Serial.print(travelTime);
+    Serial.print(travelTimeUp);
+    Serial.print('/');
+    Serial.print(travelTimeDown);
+    Serial.print('+');
+    Serial.print(overrun);
     Serial.print(',');
     if (!veluxType)
         Serial.print(F("normal"));
@@ -153,30 +237,40 @@ void RollerShutter::init(const char *id, uint8_t pinBtnUp, uint8_t pinBtnDown, u
     _btnDown.attach(pinBtnDown, INPUT_PULLUP);
     _btnDown.interval(DEBOUNCE_INTERVAL);
 
-    //save pin numbers
-    _pinRollerDir = pinRollerDir;
-    _pinRollerPower = pinRollerPower;
-
-    //save invert output
-    _invertOutput = invertOutput;
-
     //save veluxType
     _veluxType = veluxType;
 
     //setup outputs
-    pinMode(_pinRollerDir, OUTPUT);
-    pinMode(_pinRollerPower, OUTPUT);
+    if (!_veluxType)
+    {
+        //direction relay never switches under load, motor waits for direction relay
+        _rollerDir.begin(pinRollerDir, invertOutput, Actuator::Direction, &_rollerPower);
+        _rollerPower.begin(pinRollerPower, invertOutput, Actuator::Motor, &_rollerDir);
+    }
+    else
+    {
+        //2 motor relays interlocked (one waits the other to be stopped since deadTime)
+        _rollerDir.begin(pinRollerDir, invertOutput, Actuator::Motor, &_rollerPower);
+        _rollerPower.begin(pinRollerPower, invertOutput, Actuator::Motor, &_rollerDir);
+    }
 
-    //save travel time
-    _travelTime = travelTime;
+    //save travel times and overrun
+    _travelTimeUp = travelTimeUp;
+    _travelTimeDown = travelTimeDown;
+    _overrun = overrun;
+
+    //save live position publish rate
+    _liveStep = liveStep;
+    _liveInterval = liveInterval;
+
+    //save MQTT command coalescing window
+    _commandWindow = commandWindow;
 
     _initialized = true;
 
     //Close completely the Roller to initialize position
-    //Go Down
-    goDown();
-    //during full travelTime, then we are Ready
-    _outputTimer.setOnceTimeout(1000L * _travelTime);
+    //Go Down during full travelTime (and overrun to be sure to reach end stop), then we are Ready
+    goDown(_travelTimeDown + _overrun);
 }
 
 void RollerShutter::mqttSubscribe(PubSubClient &mqttClient, const char *baseTopic)
@@ -199,55 +293,7 @@ bool RollerShutter::mqttCallback(char *relevantPartOfTopic, uint8_t *payload, un
         //if topic finishes by '/command'
         if (!strcmp_P(relevantPartOfTopic + strlen(relevantPartOfTopic) - 8, PSTR("/command")))
         {
-            //Check Payload
-            if (length == 0)
-                return true;
-            if (length > 0 && (payload[0] < '0' || payload[0] > '9'))
-                return true;
-            if (length > 1 && (payload[1] < '0' || payload[1] > '9'))
-                return true;
-            if (length > 2 && (payload[2] < '0' || payload[2] > '9'))
-                return true;
-            if (length > 3)
-                return true;
-
-            //Convert requested position
-            uint16_t requestedPosition = payload[0] - '0';
-            if (length > 1)
-                requestedPosition = requestedPosition * 10 + (payload[1] - '0');
-            if (length > 2)
-                requestedPosition = requestedPosition * 10 + (payload[2] - '0');
-
-            //fix too wide value
-            if (requestedPosition > 100)
-                requestedPosition = 100;
-
-            //if roller is moving, then stop it (and then current Position will be refreshed)
-            if (_isMoving != No)
-            {
-                stop();
-                _outputTimer.stop();
-            }
-
-            //if requested is higher than current
-            if (requestedPosition > _currentPosition)
-            {
-                //Go Up for the right duration
-                goUp();
-                _outputTimer.setTimeout(((uint16_t)_travelTime) * 10 * (((float)requestedPosition) - _currentPosition));
-            }
-            else
-            {
-                //else Go Down for the right duration
-                goDown();
-                _outputTimer.setTimeout(((uint16_t)_travelTime) * 10 * (_currentPosition - requestedPosition));
-            }
-
-            Serial.print(F("[RollerShutter] "));
-            Serial.print(_id);
-            Serial.print(F(" is going to "));
-            Serial.print(requestedPosition);
-            Serial.println('%');
+            command(payload, length);
         }
 
         return true;
@@ -255,11 +301,60 @@ bool RollerShutter::mqttCallback(char *relevantPartOfTopic, uint8_t *payload, un
     return false;
 }
 
+void RollerShutter::command(uint8_t *payload, unsigned int length)
+{
+    //Check Payload
+    if (length == 0)
+        return;
+    if (length > 0 && (payload[0] < '0' || payload[0] > '9'))
+        return;
+    if (length > 1 && (payload[1] < '0' || payload[1] > '9'))
+        return;
+    if (length > 2 && (payload[2] < '0' || payload[2] > '9'))
+        return;
+    if (length > 3)
+        return;
+
+    //Convert requested position
+    uint16_t requestedPercent = payload[0] - '0';
+    if (length > 1)
+        requestedPercent = requestedPercent * 10 + (payload[1] - '0');
+    if (length > 2)
+        requestedPercent = requestedPercent * 10 + (payload[2] - '0');
+
+    //fix too wide value
+    if (requestedPercent > 100)
+        requestedPercent = 100;
+
+    _pendingCommand = requestedPercent * (ROLLERSHUTTER_POSITION_SCALE / 100);
+
+    //without window, move immediately
+    if (!_commandWindow)
+        moveTo(_pendingCommand);
+    //else first command of a burst opens the window, last one will be executed at its end
+    else if (!_commandTimer.isActive())
+        _commandTimer.setOnceTimeout(_commandWindow);
+}
+
+void RollerShutter::printStateValue(Print &out)
+{
+    out.print((livePosition() + ROLLERSHUTTER_POSITION_SCALE / 200) / (ROLLERSHUTTER_POSITION_SCALE / 100));
+};
+
 bool RollerShutter::run()
 {
     if (!_initialized)
         return false;
 
+    //movement (timer and position) starts when motor is really on
+    if (_isMoving != No && !_motorRunning && motor().isOn())
+    {
+        _motorRunning = true;
+        _movementStart = motor().lastChange();
+        _outputTimer.setOnceTimeout(_moveDuration);
+        startLivePosition();
+    }
+
     if (!_ready)
     {
         if (_outputTimer.isTimeoutOver())
@@ -283,24 +378,15 @@ bool RollerShutter::run()
             //no movement is in progress
             if (_isMoving == No)
             {
-                //Start movement
-                goUp();
-                //Start full travel time timer (even if we already are at 70%) //TODO maybe improved at a later time
-                _outputTimer.setOnceTimeout(((uint16_t)_travelTime) * 1000);
+                //Start movement for remaining distance to end stop (plus overrun to resync position)
+                goUp(moveDuration(ROLLERSHUTTER_POSITION_SCALE - _currentPosition, Up) + _overrun);
             }
             else //movement already in progress
-            {
                 stop();
-                _outputTimer.stop();
-            }
         }
         //btnUp just released AND press where longer than threshold
         if (_btnUp.rose() && _btnUp.previousDuration() > LONGPRESS_THRESHOLD)
-        {
-            //then stop
-            stop();
-            _outputTimer.stop();
-        }
+            stop(); //then stop
     }
 
     //_btnDown state changed
@@ -312,30 +398,39 @@ bool RollerShutter::run()
             //no movement is in progress
             if (_isMoving == No)
             {
-                //Start movement
-                goDown();
-                //Start full travel time timer (even if we already are at 70%) //TODO maybe improved at a later time
-                _outputTimer.setOnceTimeout(((uint16_t)_travelTime) * 1000);
+                //Start movement for remaining distance to end stop (plus overrun to resync position)
+                goDown(moveDuration(_currentPosition, Down) + _overrun);
             }
             else //movement already in progress
-            {
                 stop();
-                _outputTimer.stop();
-            }
         }
         //_btnDown just released AND press where longer than threshold
         if (_btnDown.rose() && _btnDown.previousDuration() > LONGPRESS_THRESHOLD)
-        {
-            //then stop
-            stop();
-            _outputTimer.stop();
-        }
+            stop(); //then stop
     }
 
+    //execute last MQTT command received during commandWindow
+    if (_commandTimer.isTimeoutOver())
+        moveTo(_pendingCommand);
+
+    //publish intermediate position
+    if (_liveTimer.isTimeoutOver())
+        publishPosition(livePosition());
+
     //if timer is over then Stop
     if (_outputTimer.isTimeoutOver())
         stop();
 
     //if roller is moving, we need to watch closely for buttons and timer end
     return _isMoving != No;
+};
+
+bool RollerShutter::getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId)
+{
+    if (!_initialized || index)
+        return false;
+
+    component = discoveryComponent;
+    payloadTemplate = discoveryTemplate;
+    return true;
 };
\ No newline at end of file
@@ -4,11 +4,12 @@
 #include "HADevice.h"
 
 #include <Bounce2.h>
-#include "VerySimpleTimer.h"
+#include "TimerWheel.h"
+#include "ActuatorScheduler.h"
 
 //MQTT publish :
 //  ID/state
-//    0->100
+//    0->100 (also while moving, every liveStep % at most every liveInterval ms)
 //MQTT subscribe :
 //  ID/command
 //    0->100
@@ -16,6 +17,14 @@
 #define DEBOUNCE_INTERVAL 25
 #define LONGPRESS_THRESHOLD 1000
 
+//position is tracked in fixed point (1/10000 of travel) to avoid soft float
+#define ROLLERSHUTTER_POSITION_SCALE 10000
+#define ROLLERSHUTTER_MAX_TRAVEL_TIME 300000UL   //ms (keeps distance * travelTime into 32 bits)
+#define ROLLERSHUTTER_DEFAULT_OVERRUN 1000       //ms added to moves ending at an end stop
+#define ROLLERSHUTTER_DEFAULT_LIVE_STEP 5        //% between position publish while moving
+#define ROLLERSHUTTER_DEFAULT_LIVE_INTERVAL 1000 //minimum ms between position publish while moving
+#define ROLLERSHUTTER_DEFAULT_COMMAND_WINDOW 150 //ms during which MQTT commands are coalesced (only last one is executed)
+
 class RollerShutter : public HADevice
 {
 private:
@@ -27,27 +36,49 @@ private:
   };
 
   Bounce _btnUp, _btnDown;
-  uint8_t _pinRollerDir, _pinRollerPower; //For Velux Roler Shutter : RollerDir=RollerUp; RollerPower=RollerDown
-  uint8_t _travelTime = 0;
-  bool _invertOutput = false;
+  Actuator _rollerDir, _rollerPower; //For Velux Roler Shutter : RollerDir=RollerUp; RollerPower=RollerDown
+  uint32_t _travelTimeUp = 0;   //ms
+  uint32_t _travelTimeDown = 0; //ms
+  uint16_t _overrun = 0;        //ms
+  uint8_t _liveStep = 0;        //% (0 : no publish while moving)
+  uint16_t _liveInterval = 0;   //ms
+  uint16_t _commandWindow = 0;  //ms
+  uint16_t _pendingCommand = 0; //position requested by last MQTT command (executed at end of commandWindow)
   bool _veluxType = false;
-  float _currentPosition = 0.0;
+  uint16_t _currentPosition = 0; //0->ROLLERSHUTTER_POSITION_SCALE
 
   bool _ready = false;
   unsigned long _movementStart = 0;
   Movement _isMoving = No;
-  VerySimpleTimer _outputTimer;
+  bool _motorRunning = false; //motor start can be delayed by ActuatorScheduler
+  uint32_t _moveDuration = 0; //ms, counted from motor start
+  WheelTimer _outputTimer;
+  WheelTimer _liveTimer; //publish position while moving
+  WheelTimer _commandTimer; //end of commandWindow
 
-  void goDown();
-  void goUp();
+  void goDown(uint32_t duration);
+  void goUp(uint32_t duration);
+  Actuator &motor();
   void stop();
+  void moveTo(uint16_t position);
+  void startLivePosition();
+  uint16_t movedDistance(uint32_t duration);
+  uint32_t moveDuration(uint16_t distance, Movement movement);
+  uint16_t livePosition();
+  void publishPosition(uint16_t position);
+
+protected:
+  void printStateValue(Print &out) override;
 
 public:
   RollerShutter(JsonVariant config, EventManager *evtMgr);
-  void init(const char *id, uint8_t pinBtnUp, uint8_t pinBtnDown, uint8_t pinRollerDir, uint8_t pinRollerPower, uint8_t travelTime, bool invertOutput, bool veluxType, EventManager *evtMgr);
+  ~RollerShutter();
+  void init(const char *id, uint8_t pinBtnUp, uint8_t pinBtnDown, uint8_t pinRollerDir, uint8_t pinRollerPower, uint32_t travelTimeUp, uint32_t travelTimeDown, uint16_t overrun, uint8_t liveStep, uint16_t liveInterval, uint16_t commandWindow, bool invertOutput, bool veluxType, EventManager *evtMgr);
   void mqttSubscribe(PubSubClient &mqttClient, const char *baseTopic) override;
   bool mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsigned int length) override;
+  void command(uint8_t *payload, unsigned int length) override;
   bool run() override;
+  bool getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId) override;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,339 @@
+#include "RuleEngine.h"
+#include "ActuatorScheduler.h"
+
+HADevice **RuleEngine::_devices = NULL;
+uint8_t RuleEngine::_nbSlots = 0;
+uint16_t RuleEngine::_rulesStart = 0;
+uint8_t RuleEngine::_depth = 0;
+
+//------------------------------------------
+// write one byte of program (last byte of EEPROM area is kept for end of program)
+bool RuleEngine::emit(uint16_t &pos, uint8_t b)
+{
+    if (pos >= RULEENGINE_EEPROM_START + RULEENGINE_EEPROM_SIZE - 1)
+        return false;
+
+    //update only writes changed bytes (same program compiled at each boot doesn't wear EEPROM)
+    EEPROM.update(pos++, b);
+    return true;
+}
+
+bool RuleEngine::emitString(uint16_t &pos, const char *str, const char *suffixP)
+{
+    size_t length = strlen(str);
+    size_t suffixLength = suffixP ? strlen_P(suffixP) : 0;
+    if (length + suffixLength > 255)
+        return false;
+
+    bool ok = emit(pos, length + suffixLength);
+    for (size_t i = 0; ok && i < length; i++)
+        ok = emit(pos, str[i]);
+    for (size_t i = 0; ok && i < suffixLength; i++)
+        ok = emit(pos, pgm_read_byte(suffixP + i));
+    return ok;
+}
+
+//write a JSON value (string or number) as text
+bool RuleEngine::emitText(uint16_t &pos, JsonVariant value)
+{
+    char text[RULEENGINE_MAX_TEXT + 1];
+
+    if (value.is<const char *>())
+    {
+        if (strlen(value.as<const char *>()) > RULEENGINE_MAX_TEXT)
+            return false;
+        strcpy(text, value.as<const char *>());
+    }
+    else if (serializeJson(value, text, sizeof(text)) >= sizeof(text))
+        return false;
+
+    return emitString(pos, text);
+}
+
+//give slot of a HADevice id (added to ids if not already there), -1 if ids is full
+int8_t RuleEngine::slot(const char *id, const char **ids, uint8_t &nbIds)
+{
+    if (strlen(id) > 16)
+        return -1;
+
+    for (uint8_t i = 0; i < nbIds; i++)
+        if (!strcmp(ids[i], id))
+            return i;
+
+    if (nbIds == RULEENGINE_MAX_SLOTS)
+        return -1;
+
+    ids[nbIds] = id;
+    return nbIds++;
+}
+
+//compile one rule at pos, return position after it (0 if rule is invalid or doesn't fit)
+uint16_t RuleEngine::compileRule(uint16_t pos, JsonObject rule, const char **ids, uint8_t &nbIds)
+{
+    const char *when = rule[F("when")].as<const char *>();
+    if (!when)
+    {
+        Serial.println(F("[RuleEngine][ERROR]when is missing"));
+        return 0;
+    }
+
+    uint16_t start = pos;
+    bool ok = emit(pos, 0); //rule length (written at the end)
+
+    //trigger is the event topic (only HADevice id means id/state)
+    ok = ok && emitString(pos, when, strchr(when, '/') ? NULL : PSTR("/state"));
+
+    //conditions on event payload
+    if (!rule[F("is")].isNull())
+        ok = ok && emit(pos, OpIs) && emitText(pos, rule[F("is")]);
+    if (!rule[F("not")].isNull())
+        ok = ok && emit(pos, OpNot) && emitText(pos, rule[F("not")]);
+    if (!rule[F("above")].isNull())
+    {
+        int16_t threshold = round(constrain(rule[F("above")].as<float>() * 100, -32768, 32767));
+        ok = ok && emit(pos, OpAbove) && emit(pos, threshold & 0xFF) && emit(pos, (uint16_t)threshold >> 8);
+    }
+    if (!rule[F("below")].isNull())
+    {
+        int16_t threshold = round(constrain(rule[F("below")].as<float>() * 100, -32768, 32767));
+        ok = ok && emit(pos, OpBelow) && emit(pos, threshold & 0xFF) && emit(pos, (uint16_t)threshold >> 8);
+    }
+
+    //conditions on state of other HADevices
+    for (JsonPair condition : rule[F("if")].as<JsonObject>())
+    {
+        int8_t deviceSlot = slot(condition.key().c_str(), ids, nbIds);
+        ok = ok && deviceSlot >= 0 && emit(pos, OpState) && emit(pos, deviceSlot) && emitText(pos, condition.value());
+    }
+
+    //actions ("$" forwards event payload)
+    for (JsonPair action : rule[F("then")].as<JsonObject>())
+    {
+        int8_t deviceSlot = slot(action.key().c_str(), ids, nbIds);
+        ok = ok && deviceSlot >= 0;
+        if (!strcmp_P(action.value() | "", PSTR("$")))
+            ok = ok && emit(pos, OpForward) && emit(pos, deviceSlot);
+        else
+            ok = ok && emit(pos, OpCommand) && emit(pos, deviceSlot) && emitText(pos, action.value());
+    }
+
+    if (!ok || pos - start - 1 > 255)
+    {
+        Serial.print(F("[RuleEngine][ERROR]rule skipped (invalid or too long) : "));
+        Serial.println(when);
+        return 0;
+    }
+
+    EEPROM.update(start, pos - start - 1);
+    return pos;
+}
+
+//------------------------------------------
+// compare string at pos to str, pos is moved after the string
+bool RuleEngine::matchString(uint16_t &pos, const char *str)
+{
+    uint8_t length = EEPROM.read(pos++);
+    uint16_t end = pos + length;
+    bool match = (strlen(str) == length);
+
+    for (; match && pos < end; pos++, str++)
+        match = ((char)EEPROM.read(pos) == *str);
+
+    pos = end;
+    return match;
+}
+
+//read string at pos into buffer (RULEENGINE_MAX_TEXT + 1), pos is moved after the string
+void RuleEngine::readString(uint16_t &pos, char *buffer)
+{
+    uint8_t length = EEPROM.read(pos++);
+    for (uint8_t i = 0; i < length; i++)
+        buffer[i] = EEPROM.read(pos++);
+    buffer[length] = 0;
+}
+
+//convert decimal text ("-10.25", "42") to hundredths
+bool RuleEngine::parseHundredths(const char *text, int32_t &value)
+{
+    bool negative = (*text == '-');
+    if (negative)
+        text++;
+
+    if (*text < '0' || *text > '9')
+        return false;
+
+    value = 0;
+    while (*text >= '0' && *text <= '9')
+        value = value * 10 + (*text++ - '0');
+    value *= 100;
+
+    if (*text == '.')
+    {
+        text++;
+        if (*text >= '0' && *text <= '9')
+            value += (*text++ - '0') * 10;
+        if (*text >= '0' && *text <= '9')
+            value += (*text - '0');
+    }
+
+    if (negative)
+        value = -value;
+    return true;
+}
+
+void RuleEngine::execute(uint16_t pos, uint16_t end, const char *payload)
+{
+    char text[RULEENGINE_MAX_TEXT + 1];
+    int32_t value;
+    uint8_t deviceSlot;
+
+    while (pos < end)
+    {
+        switch (EEPROM.read(pos++))
+        {
+        case OpIs:
+            if (!matchString(pos, payload))
+                return;
+            break;
+
+        case OpNot:
+            if (matchString(pos, payload))
+                return;
+            break;
+
+        case OpAbove:
+        case OpBelow:
+        {
+            bool above = (EEPROM.read(pos - 1) == OpAbove);
+            int16_t threshold = EEPROM.read(pos) | (EEPROM.read(pos + 1) << 8);
+            pos += 2;
+            if (!parseHundredths(payload, value) || (above ? value <= threshold : value >= threshold))
+                return;
+            break;
+        }
+
+        case OpState:
+            deviceSlot = EEPROM.read(pos++);
+            readString(pos, text);
+            if (deviceSlot >= _nbSlots || !_devices[deviceSlot] || !_devices[deviceSlot]->isState(text))
+                return;
+            break;
+
+        case OpCommand:
+            deviceSlot = EEPROM.read(pos++);
+            readString(pos, text);
+            if (deviceSlot < _nbSlots && _devices[deviceSlot])
+                _devices[deviceSlot]->command((uint8_t *)text, strlen(text));
+            break;
+
+        case OpForward:
+            deviceSlot = EEPROM.read(pos++);
+            strncpy(text, payload, sizeof(text) - 1);
+            text[sizeof(text) - 1] = 0;
+            if (deviceSlot < _nbSlots && _devices[deviceSlot])
+                _devices[deviceSlot]->command((uint8_t *)text, strlen(text));
+            break;
+
+        //unknown instruction (program corrupted)
+        default:
+            return;
+        }
+    }
+}
+
+//------------------------------------------
+void RuleEngine::compile(JsonArray rulesJSON)
+{
+    //forget HADevices of previous program (until resolve)
+    if (_devices)
+        delete[] _devices;
+    _devices = NULL;
+    _nbSlots = 0;
+
+    //list HADevices used by rules
+    const char *ids[RULEENGINE_MAX_SLOTS];
+    uint8_t nbIds = 0;
+    for (JsonVariant rule : rulesJSON)
+    {
+        for (JsonPair condition : rule[F("if")].as<JsonObject>())
+            slot(condition.key().c_str(), ids, nbIds);
+        for (JsonPair action : rule[F("then")].as<JsonObject>())
+            slot(action.key().c_str(), ids, nbIds);
+    }
+
+    //header : ids of slots (can't overflow : 16 x 17 bytes)
+    uint16_t pos = RULEENGINE_EEPROM_START;
+    emit(pos, nbIds);
+    for (uint8_t i = 0; i < nbIds; i++)
+        emitString(pos, ids[i]);
+    _rulesStart = pos;
+
+    //rules
+    uint8_t nbRules = 0;
+    for (JsonVariant rule : rulesJSON)
+    {
+        uint16_t end = compileRule(pos, rule.as<JsonObject>(), ids, nbIds);
+        if (end)
+        {
+            pos = end;
+            nbRules++;
+        }
+    }
+
+    //end of program
+    EEPROM.update(pos, 0);
+
+    _nbSlots = nbIds;
+    if (_nbSlots)
+    {
+        _devices = new HADevice *[_nbSlots];
+        memset(_devices, 0, _nbSlots * sizeof(HADevice *));
+    }
+
+    Serial.print(F("[RuleEngine] Rules compiled : "));
+    Serial.print(nbRules);
+    Serial.print(F(" ("));
+    Serial.print(pos + 1 - RULEENGINE_EEPROM_START);
+    Serial.println(F(" bytes)"));
+}
+
+//link slots to running HADevices (to call after each change of HADevices array)
+void RuleEngine::resolve(HADevice **haDevices, uint8_t nbHADevices)
+{
+    char id[16 + 1];
+    uint16_t pos = RULEENGINE_EEPROM_START + 1;
+
+    for (uint8_t s = 0; s < _nbSlots; s++)
+    {
+        readString(pos, id);
+        _devices[s] = NULL;
+        for (uint8_t i = 0; i < nbHADevices && !_devices[s]; i++)
+            if (haDevices[i] && haDevices[i]->isInitialized() && !strcmp(haDevices[i]->getId(), id))
+                _devices[s] = haDevices[i];
+    }
+}
+
+void RuleEngine::onEvent(const char *topic, const char *payload)
+{
+    //not compiled yet or too many rules triggering each other
+    if (!_rulesStart || _depth >= RULEENGINE_MAX_DEPTH)
+        return;
+
+    _depth++;
+    //relays transitions of all actions are applied together
+    ActuatorScheduler::hold();
+
+    uint16_t pos = _rulesStart;
+    uint8_t ruleLength;
+    while ((ruleLength = EEPROM.read(pos)))
+    {
+        uint16_t end = pos + 1 + ruleLength;
+        pos++;
+        if (matchString(pos, topic))
+            execute(pos, end, payload);
+        pos = end;
+    }
+
+    ActuatorScheduler::release();
+    _depth--;
+}
\ No newline at end of file
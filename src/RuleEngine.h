@@ -0,0 +1,61 @@
+#ifndef RuleEngine_h
+#define RuleEngine_h
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <EEPROM.h>
+
+#include "ConfigStore.h"
+#include "HADevice.h"
+
+//Local reactions to HADevices events (without MQTT broker nor Home Assistant)
+//Rules of config are compiled into a bytecode stored in EEPROM (after config JSON) :
+// [nbSlots] [id of each slot]                          HADevices used by rules (resolved into pointers in RAM)
+// [rule length] [trigger topic] [instructions...]      one per rule
+// [0]                                                  end of program
+//Strings are stored as [length][chars]
+//Each event published by a HADevice is matched against triggers then instructions of the rule are executed in order :
+//a failing condition stops the rule
+
+#define RULEENGINE_EEPROM_START (CONFIG_MAX_LENGTH + 1)
+#define RULEENGINE_EEPROM_SIZE 512
+#define RULEENGINE_MAX_SLOTS 16 //max number of different HADevices used in rules
+#define RULEENGINE_MAX_TEXT 16  //max length of a value/command
+#define RULEENGINE_MAX_DEPTH 3  //max depth of rules triggered by actions of other rules
+
+class RuleEngine
+{
+private:
+  enum OpCode : uint8_t
+  {
+    OpIs = 1,    //[text] : event payload is equal to text
+    OpNot,       //[text] : event payload is different from text
+    OpAbove,     //[int16] : event payload (hundredths) is above value
+    OpBelow,     //[int16] : event payload (hundredths) is below value
+    OpState,     //[slot][text] : state of HADevice is equal to text
+    OpCommand,   //[slot][text] : send text as command to HADevice
+    OpForward    //[slot] : send event payload as command to HADevice
+  };
+
+  static HADevice **_devices; //HADevice of each slot
+  static uint8_t _nbSlots;
+  static uint16_t _rulesStart;
+  static uint8_t _depth;
+
+  static bool emit(uint16_t &pos, uint8_t b);
+  static bool emitString(uint16_t &pos, const char *str, const char *suffixP = NULL);
+  static bool emitText(uint16_t &pos, JsonVariant value);
+  static int8_t slot(const char *id, const char **ids, uint8_t &nbIds);
+  static uint16_t compileRule(uint16_t pos, JsonObject rule, const char **ids, uint8_t &nbIds);
+  static bool matchString(uint16_t &pos, const char *str);
+  static void readString(uint16_t &pos, char *buffer);
+  static void execute(uint16_t pos, uint16_t end, const char *payload);
+
+public:
+  static void compile(JsonArray rulesJSON);
+  static void resolve(HADevice **haDevices, uint8_t nbHADevices);
+  static void onEvent(const char *topic, const char *payload);
+  static bool parseHundredths(const char *text, int32_t &value); //"-12.34" -> -1234
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "SNTPClock.h"
+
+EthernetUDP SNTPClock::_udp;
+IPAddress SNTPClock::_server = (uint32_t)0;
+int16_t SNTPClock::_utcOffset = 0;
+bool SNTPClock::_synchronized = false;
+bool SNTPClock::_waitingAnswer = false;
+uint32_t SNTPClock::_unixTime = 0;
+uint32_t SNTPClock::_syncMillis = 0;
+uint32_t SNTPClock::_requestMillis = 0;
+uint32_t SNTPClock::_nextSyncMillis = 0;
+
+bool SNTPClock::sendRequest()
+{
+    //LI=0, Version=3, Mode=3 (client), everything else is 0
+    uint8_t packet[48] = {0x1B};
+
+    if (!_udp.beginPacket(_server, SNTP_PORT))
+        return false;
+    _udp.write(packet, sizeof(packet));
+    return _udp.endPacket();
+}
+
+bool SNTPClock::readAnswer()
+{
+    uint8_t packet[48];
+
+    if (_udp.read(packet, sizeof(packet)) != (int)sizeof(packet))
+        return false;
+
+    //Mode must be 4 (server) and Stratum not 0 (kiss of death)
+    if ((packet[0] & 0x07) != 4 || !packet[1])
+        return false;
+
+    //Transmit Timestamp (seconds since 1900)
+    uint32_t seconds = ((uint32_t)packet[40] << 24) | ((uint32_t)packet[41] << 16) | ((uint32_t)packet[42] << 8) | packet[43];
+    _unixTime = seconds - SNTP_UNIX_OFFSET;
+    //answer is considered received in the middle of the round trip
+    _syncMillis = millis() - (millis() - _requestMillis) / 2;
+    _synchronized = true;
+
+    return true;
+}
+
+void SNTPClock::begin(IPAddress server, int16_t utcOffset)
+{
+    _udp.stop();
+    _server = server;
+    _utcOffset = utcOffset;
+    _waitingAnswer = false;
+    _nextSyncMillis = millis();
+
+    Serial.print(F("[SNTPClock] Server="));
+    _server.printTo(Serial);
+    Serial.print(F(" UTCOffset="));
+    Serial.println(_utcOffset);
+}
+
+void SNTPClock::run()
+{
+    //no server configured
+    if ((uint32_t)_server == 0)
+        return;
+
+    if (_waitingAnswer)
+    {
+        bool received = false;
+        if (_udp.parsePacket() > 0)
+            received = readAnswer();
+        else if (millis() - _requestMillis < SNTP_ANSWER_TIMEOUT)
+            return;
+
+        _waitingAnswer = false;
+        _udp.stop();
+        _nextSyncMillis = millis() + (received ? SNTP_SYNC_PERIOD : SNTP_FAILED_RETRY_DELAY);
+
+        if (!received)
+            Serial.println(F("[SNTPClock][ERROR]No valid answer"));
+        return;
+    }
+
+    if ((int32_t)(millis() - _nextSyncMillis) < 0)
+        return;
+
+    if (Ethernet.linkStatus() == LinkOFF || !_udp.begin(SNTP_LOCAL_PORT) || !sendRequest())
+    {
+        _udp.stop();
+        _nextSyncMillis = millis() + SNTP_FAILED_RETRY_DELAY;
+        return;
+    }
+
+    _waitingAnswer = true;
+    _requestMillis = millis();
+}
+
+bool SNTPClock::isSynchronized()
+{
+    return _synchronized;
+}
+
+uint32_t SNTPClock::now()
+{
+    return _unixTime + (millis() - _syncMillis) / 1000 + _utcOffset * 60L;
+}
+
+bool SNTPClock::minutesOfDay(uint16_t &minutes)
+{
+    if (!_synchronized)
+        return false;
+
+    minutes = (now() % 86400UL) / 60;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef SNTPClock_h
+#define SNTPClock_h
+
+#include <Arduino.h>
+#include <Ethernet.h>
+
+//Board clock synchronized by SNTP (used by HADevices schedules)
+//Request is sent then answer is polled by run() so main loop is never blocked
+//Between synchronizations (and during network outages), time is kept by millis()
+
+#define SNTP_PORT 123
+#define SNTP_LOCAL_PORT 1123
+#define SNTP_ANSWER_TIMEOUT 2000    //ms to wait for an answer
+#define SNTP_SYNC_PERIOD 3600000UL  //ms between 2 synchronizations
+#define SNTP_FAILED_RETRY_DELAY 30000 //ms before retrying after a failure
+#define SNTP_UNIX_OFFSET 2208988800UL //seconds between 1900 (NTP) and 1970 (Unix)
+
+class SNTPClock
+{
+private:
+  static EthernetUDP _udp;
+  static IPAddress _server;
+  static int16_t _utcOffset; //minutes
+  static bool _synchronized;
+  static bool _waitingAnswer;
+  static uint32_t _unixTime;   //UTC seconds received at _syncMillis
+  static uint32_t _syncMillis;
+  static uint32_t _requestMillis;
+  static uint32_t _nextSyncMillis;
+
+  static bool sendRequest();
+  static bool readAnswer();
+
+public:
+  static void begin(IPAddress server, int16_t utcOffset);
+  static void run();
+  static bool isSynchronized();
+  static uint32_t now(); //local time (seconds since 1970)
+  static bool minutesOfDay(uint16_t &minutes); //local time of day (false if clock was never synchronized)
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,72 @@
+#include "TemperatureHistory.h"
+#include "Formatters.h"
+
+void TemperatureHistory::begin(const byte romCode[], int16_t raw)
+{
+    memcpy(_romCode, romCode, 8);
+    _last = _base = _end = raw;
+    _start = 0;
+    _count = 0;
+}
+
+bool TemperatureHistory::is(const byte romCode[])
+{
+    return !memcmp(_romCode, romCode, 8);
+}
+
+void TemperatureHistory::setLast(int16_t raw)
+{
+    _last = raw;
+}
+
+//delta of the sample at index (position in _samples)
+int8_t TemperatureHistory::delta(uint16_t index)
+{
+    uint8_t nibble = _samples[index >> 1];
+    if (index & 1)
+        nibble >>= 4;
+    //sign extension of 4 bits
+    return (int8_t)((nibble & 0x0F) << 4) >> 4;
+}
+
+void TemperatureHistory::addSample()
+{
+    //rounded number of steps, limited to 4 bits
+    int16_t diff = _last - _end;
+    int16_t steps = (diff + (diff >= 0 ? TEMPERATUREHISTORY_QUANTUM / 2 : -TEMPERATUREHISTORY_QUANTUM / 2)) / TEMPERATUREHISTORY_QUANTUM;
+    int8_t delta = constrain(steps, -8, 7);
+    _end += delta * TEMPERATUREHISTORY_QUANTUM;
+
+    //ring is full : oldest sample is merged into base
+    if (_count == TEMPERATUREHISTORY_SAMPLES)
+    {
+        _base += this->delta(_start) * TEMPERATUREHISTORY_QUANTUM;
+        _start = (_start + 1) % TEMPERATUREHISTORY_SAMPLES;
+        _count--;
+    }
+
+    uint16_t index = (_start + _count) % TEMPERATUREHISTORY_SAMPLES;
+    uint8_t &sampleByte = _samples[index >> 1];
+    if (index & 1)
+        sampleByte = (sampleByte & 0x0F) | (delta << 4);
+    else
+        sampleByte = (sampleByte & 0xF0) | (delta & 0x0F);
+    _count++;
+}
+
+void TemperatureHistory::printTo(Print &out)
+{
+    char buffer[17];
+
+    formatHex(buffer, _romCode, 8);
+    out.print(buffer);
+
+    int16_t value = _base;
+    for (uint16_t i = 0; i < _count; i++)
+    {
+        value += delta((_start + i) % TEMPERATUREHISTORY_SAMPLES) * TEMPERATUREHISTORY_QUANTUM;
+        formatSixteenths(buffer, value);
+        out.print(',');
+        out.print(buffer);
+    }
+}
\ No newline at end of file
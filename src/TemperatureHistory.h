@@ -0,0 +1,36 @@
+#ifndef TemperatureHistory_h
+#define TemperatureHistory_h
+
+#include <Arduino.h>
+
+//Temperature history of one DS18B20 sensor kept in RAM (ring of samples)
+//Each sample is a 4 bits delta (-8->+7 steps of 1/8 °C) from the previous one,
+//bigger changes are spread over next samples (history follows the sensor at about 1°C per sample)
+//Values are decoded sequentially while printed, so history is never decompressed into a buffer
+//No constructor : histories are stored in a realloc'ed array, begin() initializes them
+
+#define TEMPERATUREHISTORY_SAMPLES 288 //24h at 5 min
+#define TEMPERATUREHISTORY_QUANTUM 2   //raw units (1/16 °C) per delta step
+
+class TemperatureHistory
+{
+private:
+  byte _romCode[8];
+  int16_t _last; //last reading (1/16 °C)
+  int16_t _base; //value before oldest sample
+  int16_t _end;  //value of newest sample (as decoded)
+  uint16_t _start; //index of oldest sample
+  uint16_t _count;
+  uint8_t _samples[TEMPERATUREHISTORY_SAMPLES / 2];
+
+  int8_t delta(uint16_t index);
+
+public:
+  void begin(const byte romCode[], int16_t raw);
+  bool is(const byte romCode[]);
+  void setLast(int16_t raw);
+  void addSample(); //last reading becomes a new sample
+  void printTo(Print &out); //ROMCode,oldest,...,newest
+};
+
+#endif
\ No newline at end of file
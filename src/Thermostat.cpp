@@ -0,0 +1,330 @@
+#include "Thermostat.h"
+
+//Home Assistant discovery
+static const char discoveryComponent[] PROGMEM = "climate";
+static const char discoveryTemplate[] PROGMEM = "{\"name\":\"%i\",\"uniq_id\":\"%n_%i\",\"modes\":[\"heat\"],\"temp_cmd_t\":\"%b%i/command\",\"temp_stat_t\":\"%b%i/setpoint\",\"act_t\":\"%b%i/state\",\"min_temp\":5,\"max_temp\":30,\"temp_step\":0.5,%d}";
+
+static const char stateHeating[] PROGMEM = "heating";
+static const char stateIdle[] PROGMEM = "idle";
+static const char stateOff[] PROGMEM = "off";
+
+int16_t Thermostat::toHundredths(JsonVariant value, int16_t defaultValue)
+{
+    if (value.isNull())
+        return defaultValue;
+    return (int16_t)(value.as<float>() * 100 + 0.5);
+}
+
+//time is "HH:MM"
+void Thermostat::addSwitchPoint(const char *time, int16_t setpoint)
+{
+    if (!time || strlen(time) != 5 || time[2] != ':' || _nbSwitchPoints >= THERMOSTAT_MAX_SCHEDULE)
+        return;
+
+    uint8_t hours = atoi(time);
+    uint8_t minutes = atoi(time + 3);
+    if (hours > 23 || minutes > 59)
+        return;
+
+    SwitchPoint point = {(uint16_t)(hours * 60 + minutes), (int16_t)constrain(setpoint, THERMOSTAT_MIN_SETPOINT, THERMOSTAT_MAX_SETPOINT)};
+
+    //insert sorted by time of day
+    uint8_t pos = _nbSwitchPoints++;
+    while (pos && _schedule[pos - 1].minutes > point.minutes)
+    {
+        _schedule[pos] = _schedule[pos - 1];
+        pos--;
+    }
+    _schedule[pos] = point;
+};
+
+void Thermostat::updateSchedule()
+{
+    uint16_t minutes;
+
+    //without clock, setpoint of config (or MQTT) stays in use
+    if (!_nbSwitchPoints || !SNTPClock::minutesOfDay(minutes))
+        return;
+
+    //before first switch point of the day, last one of previous day is still in use
+    uint8_t point = _nbSwitchPoints - 1;
+    for (uint8_t i = 0; i < _nbSwitchPoints && _schedule[i].minutes <= minutes; i++)
+        point = i;
+
+    //setpoint is only changed at switch points (so an MQTT override lasts until next one)
+    if (point == _switchPoint)
+        return;
+
+    _switchPoint = point;
+    setSetpoint(_schedule[point].setpoint);
+};
+
+void Thermostat::setSetpoint(int16_t setpoint)
+{
+    _setpoint = setpoint;
+
+    Serial.print(F("[Thermostat] "));
+    Serial.print(_id);
+    Serial.print(F(" setpoint : "));
+    Serial.println(_setpoint);
+
+    EventManager::Event *evt = _evtMgr->newEvent();
+    strcpy(evt->topic, _id);
+    strcat_P(evt->topic, PSTR("/setpoint"));
+    formatSetpoint(evt->payload);
+    _evtMgr->pushEvent();
+
+    control();
+};
+
+void Thermostat::control()
+{
+    State state;
+
+    if (!_fresh)
+        state = Off;
+    else if (_temperature < _setpoint - _hysteresis / 2)
+        state = Heating;
+    else if (_temperature >= _setpoint + _hysteresis / 2)
+        state = Idle;
+    //inside hysteresis band, keep heating or not
+    else
+        state = (_state == Heating) ? Heating : Idle;
+
+    uint8_t order = (state == Heating) ? THERMOSTAT_HEAT_ORDER : ((state == Idle) ? _idleOrder : _fallbackOrder);
+
+    if (state != _state)
+    {
+        _state = state;
+
+        EventManager::Event *evt = _evtMgr->newEvent();
+        strcpy(evt->topic, _id);
+        strcat_P(evt->topic, PSTR("/state"));
+        strcpy_P(evt->payload, state == Heating ? stateHeating : (state == Idle ? stateIdle : stateOff));
+
+        Serial.print(F("[Thermostat] "));
+        Serial.print(_id);
+        Serial.print(F(" : "));
+        Serial.println(evt->payload);
+
+        _evtMgr->pushEvent();
+    }
+
+    if (order == _order || !_heater)
+        return;
+
+    _order = order;
+
+    //same payload as heater command topic
+    char payload[4];
+    utoa(_order, payload, 10);
+    _heater->command((uint8_t *)payload, strlen(payload));
+};
+
+void Thermostat::formatSetpoint(char *buffer)
+{
+    sprintf_P(buffer, PSTR("%d.%02d"), _setpoint / 100, _setpoint % 100);
+};
+
+Thermostat::Thermostat(JsonVariant config, EventManager *evtMgr)
+{
+    if (!config["id"].is<const char *>())
+        return;
+
+    if (!config["heater"].is<const char *>() || !config["sensor"].is<const char *>())
+        return;
+
+    //call Init with parsed values
+    init(config["id"].as<const char *>(), config["heater"].as<const char *>(), config["sensor"].as<const char *>(), toHundredths(config["setpoint"], THERMOSTAT_DEFAULT_SETPOINT), toHundredths(config["hysteresis"], THERMOSTAT_DEFAULT_HYSTERESIS), config["timeout"] | (uint16_t)THERMOSTAT_DEFAULT_TIMEOUT, config["idleOrder"] | (uint8_t)THERMOSTAT_DEFAULT_IDLE_ORDER, config["fallbackOrder"] | (uint8_t)THERMOSTAT_DEFAULT_FALLBACK_ORDER, evtMgr);
+
+    if (!_initialized)
+        return;
+
+    //schedule : [["06:30",20],["22:00",17],...]
+    for (JsonArray point : config["schedule"].as<JsonArray>())
+        addSwitchPoint(point[0].as<const char *>(), toHundredths(point[1], THERMOSTAT_DEFAULT_SETPOINT));
+
+    if (_nbSwitchPoints)
+    {
+        _scheduleTimer.setTimeout(THERMOSTAT_SCHEDULE_PERIOD);
+        updateSchedule();
+    }
+};
+
+void Thermostat::init(const char *id, const char *heaterId, const char *sensor, int16_t setpoint, int16_t hysteresis, uint16_t timeout, uint8_t idleOrder, uint8_t fallbackOrder, EventManager *evtMgr)
+{
+    Serial.print(F("[Thermostat] Init("));
+    Serial.print(id);
+    Serial.print(',');
+    Serial.print(heaterId);
+    Serial.print(',');
+    Serial.print(sensor);
+    Serial.println(')');
+
+    if (strlen(id) >= sizeof(_id) || strlen(heaterId) >= sizeof(_heaterId) || strlen(sensor) != 16)
+    {
+        Serial.println(F("[Thermostat][ERROR]Incorrect id, heater id or sensor ROMCode"));
+        return;
+    }
+
+    //save pointer to Eventmanager
+    _evtMgr = evtMgr;
+
+    //copy id, heater id and sensor ROMCode
+    strcpy(_id, id);
+    strcpy(_heaterId, heaterId);
+    strcpy(_sensor, sensor);
+
+    _setpoint = constrain(setpoint, THERMOSTAT_MIN_SETPOINT, THERMOSTAT_MAX_SETPOINT);
+    _hysteresis = hysteresis;
+    _timeout = timeout * 1000UL;
+    _idleOrder = idleOrder;
+    _fallbackOrder = fallbackOrder;
+
+    _initialized = true;
+
+    //Initialization publish (heater gets fallback order until first reading)
+    setSetpoint(_setpoint);
+    _evtMgr->addEvent((String(_id) + F("/state")).c_str(), "off");
+};
+
+void Thermostat::mqttSubscribe(PubSubClient &mqttClient, const char *baseTopic)
+{
+    char *completeTopic = new char[strlen(baseTopic) + 1 + strlen(_id) + 8 + 1]; // /command
+    strcpy(completeTopic, baseTopic);
+    if (baseTopic[strlen(baseTopic) - 1] != '/')
+        strcat(completeTopic, "/");
+    strcat(completeTopic, _id);
+    strcat_P(completeTopic, PSTR("/command"));
+    mqttClient.subscribe(completeTopic);
+    delete[] completeTopic;
+};
+
+bool Thermostat::mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsigned int length)
+{
+    //if relevantPartOfTopic starts with id of this device ending with '/'
+    if (!strncmp(relevantPartOfTopic, _id, strlen(_id)) && relevantPartOfTopic[strlen(_id)] == '/')
+    {
+        //if topic finishes by '/command'
+        if (!strcmp_P(relevantPartOfTopic + strlen(relevantPartOfTopic) - 8, PSTR("/command")))
+        {
+            command(payload, length);
+        }
+
+        return true;
+    }
+    return false;
+};
+
+void Thermostat::command(uint8_t *payload, unsigned int length)
+{
+    char text[10 + 1];
+    int32_t setpoint;
+
+    if (!_initialized || !length || length >= sizeof(text))
+        return;
+
+    memcpy(text, payload, length);
+    text[length] = 0;
+
+    if (!RuleEngine::parseHundredths(text, setpoint))
+        return;
+
+    //override lasts until next switch point of schedule
+    setSetpoint(constrain(setpoint, THERMOSTAT_MIN_SETPOINT, THERMOSTAT_MAX_SETPOINT));
+};
+
+void Thermostat::printStateValue(Print &out)
+{
+    char buffer[7];
+    formatSetpoint(buffer);
+    out.print(buffer);
+};
+
+bool Thermostat::run()
+{
+    //sensor is silent : heater is put in fallback order
+    if (_readingTimer.isTimeoutOver())
+    {
+        Serial.print(F("[Thermostat][ERROR]No reading for "));
+        Serial.println(_id);
+        _fresh = false;
+        control();
+    }
+
+    if (_scheduleTimer.isTimeoutOver())
+        updateSchedule();
+
+    return false;
+};
+
+bool Thermostat::getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId)
+{
+    if (!_initialized || index)
+        return false;
+
+    component = discoveryComponent;
+    payloadTemplate = discoveryTemplate;
+    return true;
+};
+
+void Thermostat::onEvent(const char *topic, const char *payload)
+{
+    if (!_initialized)
+        return;
+
+    //reading of a DS18B20Bus : {DS18B20Bus ID}/temperatures/{ROMCode}/temperature
+    const char *romCode = strstr_P(topic, PSTR("/temperatures/"));
+    if (!romCode)
+        return;
+    romCode += 14;
+
+    if (strncasecmp(romCode, _sensor, 16) || strcmp_P(romCode + 16, PSTR("/temperature")))
+        return;
+
+    int32_t temperature;
+    if (!RuleEngine::parseHundredths(payload, temperature))
+        return;
+
+    //an implausible reading doesn't drive the heater (nor delays fallback)
+    if (temperature < THERMOSTAT_MIN_READING || temperature > THERMOSTAT_MAX_READING || temperature == THERMOSTAT_POWER_ON_READING)
+    {
+        Serial.print(F("[Thermostat][ERROR]Reading ignored for "));
+        Serial.println(_id);
+        return;
+    }
+
+    _temperature = temperature;
+    _fresh = true;
+    _readingTimer.setOnceTimeout(_timeout);
+
+    control();
+};
+
+void Thermostat::resolve(HADevice **haDevices, uint8_t nbHADevices)
+{
+    PilotWire *heater = NULL;
+
+    for (uint8_t i = 0; i < nbHADevices; i++)
+    {
+        if (!haDevices[i] || !haDevices[i]->isInitialized() || strcmp(haDevices[i]->getId(), _heaterId))
+            continue;
+
+        //orders would be understood as positions or brightness by other devices
+        heater = haDevices[i]->asPilotWire();
+        if (!heater)
+        {
+            Serial.print(F("[Thermostat][ERROR]Heater is not a PilotWire : "));
+            Serial.println(_heaterId);
+        }
+        break;
+    }
+
+    if (heater == _heater)
+        return;
+
+    //new (or recreated) heater gets current order
+    _heater = heater;
+    _order = 0xFF;
+    control();
+};
\ No newline at end of file
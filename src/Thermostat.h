@@ -0,0 +1,102 @@
+#ifndef Thermostat_h
+#define Thermostat_h
+
+#include "HADevice.h"
+#include "PilotWire.h"
+#include "TimerWheel.h"
+#include "RuleEngine.h"
+#include "SNTPClock.h"
+
+//Room temperature control done by the board (without MQTT broker nor Home Assistant)
+//Each reading of the DS18B20 sensor (event of its DS18B20Bus) is handled immediately :
+// - below setpoint - hysteresis/2 : heater gets Confort order
+// - above setpoint + hysteresis/2 : heater gets idle order (Hors Gel by default)
+//If no valid reading is received during timeout (sensor or bus failure), heater gets fallback order (Eco by default)
+//(readings out of DS18B20 range and power-on value 85°C are ignored)
+//Setpoint comes from schedule (daily switch points, once SNTPClock is synchronized) or from config,
+//an MQTT setpoint overrides it until next switch point
+//Orders are sent to the heater (PilotWire) only when they change
+
+//MQTT publish :
+//  ID/state
+//    heating/idle/off (off : no reading, fallback order is used)
+//  ID/setpoint
+//    5.00->30.00
+//MQTT subscribe :
+//  ID/command
+//    5->30 (setpoint)
+
+#define THERMOSTAT_MAX_SCHEDULE 8         //switch points per day
+#define THERMOSTAT_MIN_SETPOINT 500       //hundredths of °C
+#define THERMOSTAT_MAX_SETPOINT 3000      //hundredths of °C
+#define THERMOSTAT_HEAT_ORDER 51          //Confort
+#define THERMOSTAT_SCHEDULE_PERIOD 10000  //ms between 2 schedule checks
+#define THERMOSTAT_MIN_READING -5500      //hundredths of °C (DS18B20 range)
+#define THERMOSTAT_MAX_READING 12500      //hundredths of °C (DS18B20 range)
+#define THERMOSTAT_POWER_ON_READING 8500  //hundredths of °C (DS18B20 scratchpad read without conversion)
+
+#define THERMOSTAT_DEFAULT_SETPOINT 1900     //hundredths of °C
+#define THERMOSTAT_DEFAULT_HYSTERESIS 50     //hundredths of °C
+#define THERMOSTAT_DEFAULT_TIMEOUT 900       //s (more than the 10 minutes full refresh of a DS18B20Bus using deadband)
+#define THERMOSTAT_DEFAULT_IDLE_ORDER 11     //Hors Gel
+#define THERMOSTAT_DEFAULT_FALLBACK_ORDER 21 //Eco
+
+class Thermostat : public HADevice
+{
+private:
+  enum State : uint8_t
+  {
+    Off, //no reading, fallback order is used
+    Idle,
+    Heating
+  };
+
+  struct SwitchPoint
+  {
+    uint16_t minutes; //time of day
+    int16_t setpoint; //hundredths of °C
+  };
+
+  char _heaterId[16 + 1] = {0};
+  PilotWire *_heater = NULL; //resolved from _heaterId
+  char _sensor[16 + 1] = {0}; //ROMCode
+  int16_t _setpoint = THERMOSTAT_DEFAULT_SETPOINT;
+  int16_t _hysteresis = THERMOSTAT_DEFAULT_HYSTERESIS;
+  uint8_t _idleOrder = THERMOSTAT_DEFAULT_IDLE_ORDER;
+  uint8_t _fallbackOrder = THERMOSTAT_DEFAULT_FALLBACK_ORDER;
+  uint8_t _order = 0xFF; //last order sent to heater
+  State _state = Off;
+
+  int32_t _temperature = 0; //last reading (hundredths of °C)
+  bool _fresh = false;      //a reading was received during timeout
+  uint32_t _timeout = THERMOSTAT_DEFAULT_TIMEOUT * 1000UL;
+  WheelTimer _readingTimer;
+
+  SwitchPoint _schedule[THERMOSTAT_MAX_SCHEDULE]; //sorted by time of day
+  uint8_t _nbSwitchPoints = 0;
+  uint8_t _switchPoint = 0xFF; //switch point in use (0xFF : none yet)
+  WheelTimer _scheduleTimer;
+
+  static int16_t toHundredths(JsonVariant value, int16_t defaultValue);
+  void addSwitchPoint(const char *time, int16_t setpoint);
+  void updateSchedule();
+  void setSetpoint(int16_t setpoint);
+  void control();
+  void formatSetpoint(char *buffer);
+
+protected:
+  void printStateValue(Print &out) override;
+
+public:
+  Thermostat(JsonVariant config, EventManager *evtMgr);
+  void init(const char *id, const char *heaterId, const char *sensor, int16_t setpoint, int16_t hysteresis, uint16_t timeout, uint8_t idleOrder, uint8_t fallbackOrder, EventManager *evtMgr);
+  void mqttSubscribe(PubSubClient &mqttClient, const char *baseTopic) override;
+  bool mqttCallback(char *relevantPartOfTopic, uint8_t *payload, unsigned int length) override;
+  void command(uint8_t *payload, unsigned int length) override;
+  bool run() override;
+  bool getDiscovery(uint8_t index, PGM_P &component, PGM_P &payloadTemplate, char *subId) override;
+  void onEvent(const char *topic, const char *payload) override;
+  void resolve(HADevice **haDevices, uint8_t nbHADevices) override;
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "TimerWheel.h"
+
+WheelTimer *TimerWheel::_slots[TIMERWHEEL_LEVELS][TIMERWHEEL_SLOTS];
+uint32_t TimerWheel::_now = 0;
+
+//------------------------------------------
+// Move timers of the current slot of a level into lower levels
+void TimerWheel::cascade(uint8_t level)
+{
+    WheelTimer **slot = &_slots[level][(_now >> (level * TIMERWHEEL_SLOT_BITS)) & (TIMERWHEEL_SLOTS - 1)];
+    WheelTimer *timer = *slot;
+    *slot = NULL;
+
+    while (timer)
+    {
+        WheelTimer *next = timer->_next;
+        insert(timer);
+        timer = next;
+    }
+}
+
+//------------------------------------------
+// Tag timers of a level 0 slot as expired (periodic ones are inserted again)
+void TimerWheel::expireSlot(WheelTimer **slot)
+{
+    WheelTimer *timer = *slot;
+    *slot = NULL;
+
+    while (timer)
+    {
+        WheelTimer *next = timer->_next;
+        timer->_next = NULL;
+        timer->_pprev = NULL;
+
+        timer->_expired = true;
+        if (timer->_once)
+            timer->_active = false;
+        else
+        {
+            //next deadline is based on previous one (no drift)
+            timer->_deadline += timer->_timeoutDuration;
+            insert(timer);
+        }
+
+        timer = next;
+    }
+}
+
+void TimerWheel::insert(WheelTimer *timer)
+{
+    //overdue deadline is handled at next tick
+    uint32_t expires = ((int32_t)(timer->_deadline - _now) > 0) ? timer->_deadline : _now + 1;
+
+    //lowest level where deadline and now share all upper bits
+    uint8_t level = 0;
+    while (level < TIMERWHEEL_LEVELS - 1 && ((expires ^ _now) >> ((level + 1) * TIMERWHEEL_SLOT_BITS)))
+        level++;
+
+    WheelTimer **slot = &_slots[level][(expires >> (level * TIMERWHEEL_SLOT_BITS)) & (TIMERWHEEL_SLOTS - 1)];
+
+    timer->_next = *slot;
+    if (*slot)
+        (*slot)->_pprev = &timer->_next;
+    *slot = timer;
+    timer->_pprev = slot;
+}
+
+void TimerWheel::remove(WheelTimer *timer)
+{
+    if (!timer->_pprev)
+        return;
+
+    *timer->_pprev = timer->_next;
+    if (timer->_next)
+        timer->_next->_pprev = timer->_pprev;
+
+    timer->_next = NULL;
+    timer->_pprev = NULL;
+}
+
+void TimerWheel::run()
+{
+    uint32_t target = millis();
+
+    while ((int32_t)(target - _now) > 0)
+    {
+        _now++;
+
+        //when lower level index wraps, cascade next slot of upper level
+        for (uint8_t level = 1; level < TIMERWHEEL_LEVELS && !(_now & ((1UL << (level * TIMERWHEEL_SLOT_BITS)) - 1)); level++)
+            cascade(level);
+
+        expireSlot(&_slots[0][_now & (TIMERWHEEL_SLOTS - 1)]);
+    }
+}
+
+uint32_t TimerWheel::idleTime()
+{
+    for (uint8_t level = 0; level < TIMERWHEEL_LEVELS; level++)
+    {
+        uint8_t shift = level * TIMERWHEEL_SLOT_BITS;
+        uint32_t levelNow = _now >> shift;
+
+        //first used slot after current index (for upper levels, that is the cascade time)
+        for (uint8_t i = 1; i < TIMERWHEEL_SLOTS; i++)
+        {
+            if (!_slots[level][(levelNow + i) & (TIMERWHEEL_SLOTS - 1)])
+                continue;
+
+            uint32_t deadline = ((levelNow + i) << shift) - _now;
+            uint32_t elapsed = millis() - _now;
+            return (deadline > elapsed) ? deadline - elapsed : 0;
+        }
+    }
+    return 0xFFFFFFFF;
+}
+
+//------------------------------------------
+WheelTimer::~WheelTimer()
+{
+    TimerWheel::remove(this);
+}
+
+void WheelTimer::setOnceTimeout(uint32_t d)
+{
+    setTimeout(d);
+    _once = true;
+};
+void WheelTimer::setTimeout(uint32_t d)
+{
+    _once = false;
+    _timeoutDuration = d;
+    reset();
+};
+void WheelTimer::reset()
+{
+    TimerWheel::remove(this);
+    _deadline = millis() + _timeoutDuration;
+    _active = true;
+    _expired = false;
+    TimerWheel::insert(this);
+};
+void WheelTimer::stop()
+{
+    TimerWheel::remove(this);
+    _active = false;
+    _expired = false;
+};
+bool WheelTimer::isTimeoutOver()
+{
+    if (!_expired)
+        return false;
+
+    _expired = false;
+    return true;
+};
+
+//a once timer stays active until its timeout is consumed by isTimeoutOver()
+bool WheelTimer::isActive()
+{
+    return _active || _expired;
+};
\ No newline at end of file
@@ -0,0 +1,64 @@
+#ifndef TimerWheel_h
+#define TimerWheel_h
+
+#include <Arduino.h>
+
+//Hierarchical timer wheel (1 tick = 1ms)
+//32 bits deadlines are split into 8 levels of 4 bits :
+// - level 0 holds timers expiring in the next 16ms (one slot per ms)
+// - level N holds timers expiring later, one slot per 16^N ms
+//When a level index wraps, the next slot of upper level is redistributed (cascade) into lower levels
+//Insert and cancel are O(1) (doubly linked lists), each tick only touches expired (or cascaded) timers
+//Deadlines are compared as differences so millis() wrap (49.7 days) is handled
+
+#define TIMERWHEEL_LEVELS 8
+#define TIMERWHEEL_SLOT_BITS 4
+#define TIMERWHEEL_SLOTS (1 << TIMERWHEEL_SLOT_BITS)
+
+class WheelTimer;
+
+class TimerWheel
+{
+private:
+  static WheelTimer *_slots[TIMERWHEEL_LEVELS][TIMERWHEEL_SLOTS];
+  static uint32_t _now; //last processed tick
+
+  static void cascade(uint8_t level);
+  static void expireSlot(WheelTimer **slot);
+
+public:
+  static void insert(WheelTimer *timer);
+  static void remove(WheelTimer *timer);
+  static void run();
+  static uint32_t idleTime(); //ms before next deadline (0xFFFFFFFF if no timer is armed)
+};
+
+//Timer registered into the TimerWheel (same usage as the previous VerySimpleTimer)
+class WheelTimer
+{
+  friend class TimerWheel;
+
+private:
+  WheelTimer *_next = NULL;
+  WheelTimer **_pprev = NULL; //pointer to the pointer that points to this timer (O(1) unlink)
+  uint32_t _deadline = 0;
+  uint32_t _timeoutDuration = 0;
+  bool _active = false;
+  bool _once = false;
+  bool _expired = false; //timeout is over and not yet consumed by isTimeoutOver()
+
+  WheelTimer(const WheelTimer &) = delete;
+  WheelTimer &operator=(const WheelTimer &) = delete;
+
+public:
+  WheelTimer() {}
+  ~WheelTimer();
+  void setOnceTimeout(uint32_t d);
+  void setTimeout(uint32_t d);
+  void reset();
+  void stop();
+  bool isTimeoutOver();
+  bool isActive();
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,299 @@
+#include "UARTOneWire.h"
+
+//baud rate registers (double speed mode)
+#define UARTONEWIRE_RESET_UBRR ((F_CPU / 4 / 9600 - 1) / 2)
+#define UARTONEWIRE_SLOT_UBRR ((F_CPU / 4 / 115200 - 1) / 2)
+
+UARTOneWire *UARTOneWire::_uarts[UARTONEWIRE_NB_UARTS] = {NULL, NULL, NULL};
+
+ISR(USART1_RX_vect)
+{
+    UARTOneWire::rxInterrupt(0);
+}
+ISR(USART2_RX_vect)
+{
+    UARTOneWire::rxInterrupt(1);
+}
+ISR(USART3_RX_vect)
+{
+    UARTOneWire::rxInterrupt(2);
+}
+
+void UARTOneWire::rxInterrupt(uint8_t uart)
+{
+    UARTOneWire *bus = _uarts[uart];
+    if (bus)
+        bus->received(*bus->_udr);
+}
+
+//------------------------------------------
+// Time slots
+void UARTOneWire::startReset(Op op)
+{
+    //drop any old echo
+    while (*_ucsra & (1 << RXC1))
+        (void)*_udr;
+
+    _startTime = millis();
+    _op = op;
+    *_ubrr = UARTONEWIRE_RESET_UBRR;
+    *_udr = 0xF0;
+}
+
+void UARTOneWire::sendSlot(bool bit)
+{
+    *_udr = bit ? 0xFF : 0x00;
+}
+
+//Echo of a slot received : read its result then send next slot
+void UARTOneWire::received(uint8_t echo)
+{
+    switch (_op)
+    {
+    case Reset:
+    case SearchReset:
+        *_ubrr = UARTONEWIRE_SLOT_UBRR;
+        _bitIndex = 0;
+
+        //presence pulses modify the echo
+        _result = (echo != 0xF0);
+        if (!_result)
+        {
+            if (_op == SearchReset)
+                resetSearch();
+            _op = Idle;
+        }
+        else if (_op == SearchReset)
+        {
+            _op = SearchCommand;
+            sendSlot(_searchCommand & 1);
+        }
+        else if (_length)
+        {
+            _op = Transfer;
+            sendSlot(_data[0] & 1);
+        }
+        else
+            _op = Idle;
+        break;
+
+    case Transfer:
+    {
+        //written bits are read back unchanged, read slots (1) are replaced by the bus level
+        uint8_t mask = 1 << (_bitIndex & 7);
+        if (echo == 0xFF)
+            _data[_bitIndex >> 3] |= mask;
+        else
+            _data[_bitIndex >> 3] &= ~mask;
+
+        _bitIndex++;
+        if (_bitIndex < _length * 8)
+            sendSlot(_data[_bitIndex >> 3] & (1 << (_bitIndex & 7)));
+        else
+            _op = Idle;
+        break;
+    }
+
+    case SearchCommand:
+        _bitIndex++;
+        if (_bitIndex < 8)
+            sendSlot(_searchCommand & (1 << _bitIndex));
+        else
+        {
+            _op = SearchBits;
+            _bitIndex = 0;
+            _searchStep = 0;
+            _lastZero = 0;
+            sendSlot(true);
+        }
+        break;
+
+    case SearchBits:
+        searchBit(echo == 0xFF);
+        break;
+
+    default:
+        break;
+    }
+}
+
+//------------------------------------------
+// One step of ROM search : read bit, read its complement, write selected direction
+void UARTOneWire::searchBit(bool bit)
+{
+    uint8_t &romByte = _romCode[_bitIndex >> 3];
+    uint8_t mask = 1 << (_bitIndex & 7);
+
+    switch (_searchStep)
+    {
+    case 0:
+        _idBit = bit;
+        _searchStep = 1;
+        sendSlot(true);
+        break;
+
+    case 1:
+    {
+        //no device answered
+        if (_idBit && bit)
+        {
+            _result = false;
+            resetSearch();
+            _op = Idle;
+            return;
+        }
+
+        bool direction;
+        if (_idBit != bit)
+            direction = _idBit;
+        else
+        {
+            //discrepancy : same path as previous search before last discrepancy, 1 at it, 0 after it
+            uint8_t bitNumber = _bitIndex + 1;
+            if (bitNumber < _lastDiscrepancy)
+                direction = romByte & mask;
+            else
+                direction = (bitNumber == _lastDiscrepancy);
+            if (!direction)
+                _lastZero = bitNumber;
+        }
+
+        if (direction)
+            romByte |= mask;
+        else
+            romByte &= ~mask;
+
+        _searchStep = 2;
+        sendSlot(direction);
+        break;
+    }
+
+    default:
+        _bitIndex++;
+        if (_bitIndex < 64)
+        {
+            _searchStep = 0;
+            sendSlot(true);
+            break;
+        }
+
+        _lastDiscrepancy = _lastZero;
+        _lastDevice = !_lastZero;
+        _result = true;
+        _op = Idle;
+        break;
+    }
+}
+
+//------------------------------------------
+UARTOneWire::UARTOneWire(uint8_t serial)
+{
+    switch (serial)
+    {
+    case 1:
+        _ucsra = &UCSR1A;
+        _ucsrb = &UCSR1B;
+        _ucsrc = &UCSR1C;
+        _ubrr = &UBRR1;
+        _udr = &UDR1;
+        break;
+    case 2:
+        _ucsra = &UCSR2A;
+        _ucsrb = &UCSR2B;
+        _ucsrc = &UCSR2C;
+        _ubrr = &UBRR2;
+        _udr = &UDR2;
+        break;
+    default:
+        serial = 3;
+        _ucsra = &UCSR3A;
+        _ucsrb = &UCSR3B;
+        _ucsrc = &UCSR3C;
+        _ubrr = &UBRR3;
+        _udr = &UDR3;
+        break;
+    }
+    _uart = serial - 1;
+    _uarts[_uart] = this;
+
+    //8N1, double speed, RX interrupt
+    *_ubrr = UARTONEWIRE_SLOT_UBRR;
+    *_ucsra = (1 << U2X1);
+    *_ucsrc = (1 << UCSZ11) | (1 << UCSZ10);
+    *_ucsrb = (1 << RXEN1) | (1 << TXEN1) | (1 << RXCIE1);
+}
+
+UARTOneWire::~UARTOneWire()
+{
+    *_ucsrb = 0;
+    _uarts[_uart] = NULL;
+}
+
+void UARTOneWire::transaction(uint8_t *data, uint8_t length)
+{
+    _data = data;
+    _length = length;
+    startReset(Reset);
+}
+
+void UARTOneWire::resetSearch()
+{
+    _lastDiscrepancy = 0;
+    _lastDevice = false;
+    memset(_romCode, 0, sizeof(_romCode));
+}
+
+void UARTOneWire::search(bool alarmOnly)
+{
+    //previous search found the last device
+    if (_lastDevice)
+    {
+        resetSearch();
+        _result = false;
+        return;
+    }
+
+    _searchCommand = alarmOnly ? 0xEC : 0xF0;
+    startReset(SearchReset);
+}
+
+const uint8_t *UARTOneWire::romCode()
+{
+    return _romCode;
+}
+
+bool UARTOneWire::busy()
+{
+    if (_op == Idle)
+        return false;
+
+    if (millis() - _startTime < UARTONEWIRE_TIMEOUT)
+        return true;
+
+    //no echo received : abort operation
+    cli();
+    _op = Idle;
+    _result = false;
+    *_ubrr = UARTONEWIRE_SLOT_UBRR;
+    sei();
+
+    Serial.println(F("[UARTOneWire][ERROR]Operation timeout (TX and RX must be joined)"));
+    return false;
+}
+
+bool UARTOneWire::result()
+{
+    return _result;
+}
+
+uint8_t UARTOneWire::txPin(uint8_t serial)
+{
+    //Serial1 : 18, Serial2 : 16, Serial3 : 14
+    return 20 - 2 * serial;
+}
+
+uint8_t UARTOneWire::rxPin(uint8_t serial)
+{
+    //Serial1 : 19, Serial2 : 17, Serial3 : 15
+    return 21 - 2 * serial;
+}
\ No newline at end of file
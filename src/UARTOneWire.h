@@ -0,0 +1,79 @@
+#ifndef UARTOneWire_h
+#define UARTOneWire_h
+
+#include "OneWireMaster.h"
+
+//1-Wire bus on a hardware UART (Serial1, Serial2 or Serial3), TX and RX joined :
+//  TX ---|<|--- DATA (diode cathode on TX side, 1N4148 or schottky)
+//  RX ----------DATA
+//  4.7K resistor between VCC and DATA
+//Each 1-Wire time slot is a UART frame whose echo is read back (DS2480 principle) :
+// - reset : 0xF0 at 9600 bauds, echo is modified by presence pulses
+// - write 0 : 0x00 at 115200 bauds
+// - write 1/read : 0xFF at 115200 bauds, echo is 0xFF only if no device pulled DATA low
+//Next slot is sent by the RX interrupt, so transactions run in background without disabling interrupts
+//The Serial object of this UART must not be used
+
+#define UARTONEWIRE_NB_UARTS 3
+#define UARTONEWIRE_TIMEOUT 50 //ms, an operation longer than this is aborted (TX and RX not joined)
+
+class UARTOneWire : public OneWireMaster
+{
+private:
+  enum Op : uint8_t
+  {
+    Idle,
+    Reset,
+    Transfer,
+    SearchReset,
+    SearchCommand,
+    SearchBits
+  };
+
+  static UARTOneWire *_uarts[UARTONEWIRE_NB_UARTS];
+
+  volatile uint8_t *_ucsra;
+  volatile uint8_t *_ucsrb;
+  volatile uint8_t *_ucsrc;
+  volatile uint16_t *_ubrr;
+  volatile uint8_t *_udr;
+  uint8_t _uart;
+
+  volatile Op _op = Idle;
+  volatile bool _result = false;
+  uint32_t _startTime = 0;
+
+  //current transfer
+  uint8_t *_data = NULL;
+  uint8_t _length = 0;
+  uint8_t _bitIndex = 0;
+
+  //search state (ROMCode is built in place bit after bit)
+  uint8_t _romCode[8];
+  uint8_t _searchCommand = 0xF0;
+  uint8_t _searchStep = 0; //0 : read bit, 1 : read complement, 2 : write direction
+  bool _idBit = false;
+  uint8_t _lastDiscrepancy = 0;
+  uint8_t _lastZero = 0;
+  bool _lastDevice = false;
+
+  void startReset(Op op);
+  void sendSlot(bool bit);
+  void received(uint8_t echo);
+  void searchBit(bool bit);
+
+public:
+  UARTOneWire(uint8_t serial); //1->3
+  ~UARTOneWire();
+  void transaction(uint8_t *data, uint8_t length) override;
+  void resetSearch() override;
+  void search(bool alarmOnly = false) override;
+  const uint8_t *romCode() override;
+  bool busy() override;
+  bool result() override;
+  static uint8_t txPin(uint8_t serial);
+  static uint8_t rxPin(uint8_t serial);
+  static void rxInterrupt(uint8_t uart); //called by interrupt
+};
+
+#endif
\ No newline at end of file
@@ -1,22 +1,38 @@
 #include <Arduino.h>
 #include <avr/boot.h>
 #include <avr/wdt.h>
+#include <avr/sleep.h>
 #include <SPI.h>
 #include <Ethernet.h>
 #include <EEPROM.h>
 #include <ArduinoJson.h>
 #include <PubSubClient.h>
-#include "VerySimpleTimer.h"
+#include "TimerWheel.h"
+#include "DNSResolver.h"
+#include "PrintHelpers.h"
+#include "HADiscovery.h"
+#include "ConfigStore.h"
+#include "ActuatorScheduler.h"
 
 #include "WebServer.h"
 #include "EventManager.h"
 
 #include "HADevice.h"
+#include "HAGroup.h"
+#include "RuleEngine.h"
 #include "Light.h"
 #include "RollerShutter.h"
 #include "DS18B20Bus.h"
 #include "PilotWire.h"
 #include "DigitalOut.h"
+#include "DimmableLight.h"
+#include "PulseCounter.h"
+#include "AnalogIn.h"
+#include "DigitalIn.h"
+#include "DS18B20Coordinator.h"
+#include "PilotWireScheduler.h"
+#include "Thermostat.h"
+#include "SNTPClock.h"
 
 //Web Resources
 #include "data\pure-min.css.gz.h"
@@ -38,6 +54,10 @@
 
 #define GLOBAL_BUFFER_AND_JSONDOC_SIZE 1536 //minimum size is 1024 (web answer)
 
+#define CONFIG_DEVICE_MAX_LENGTH 256  //max length of one HADevices entry (minified) for partial config update
+#define CONFIG_DEVICE_JSONDOC_SIZE 512 //JsonDocument size used to parse one HADevices entry
+#define MQTT_BUFFER_SIZE 384           //PubSubClient buffer needs to receive one HADevices entry (+topic)
+
 //GLOBAL USAGE
 char globalBuffer[GLOBAL_BUFFER_AND_JSONDOC_SIZE];
 
@@ -49,10 +69,13 @@ struct
   {
     char name[16 + 1] = {0}; //system name (max 16 char)
     IPAddress ip = (uint32_t)0;
+    IPAddress ntp = (uint32_t)0; //SNTP server
+    int16_t timezone = 0;        //offset from UTC in minutes
   } system;
   struct
   {
     char hostname[32 + 1] = {0};
+    IPAddress fallbackIP = (uint32_t)0;
     uint32_t port = 1883;
     char username[16 + 1] = {0};
     char password[16 + 1] = {0};
@@ -60,6 +83,10 @@ struct
   } mqtt;
 } config;
 
+//hash of System and MQTT config parts (to detect changes at config reload)
+uint16_t configSystemHash = 0;
+uint16_t configMQTTHash = 0;
+
 //eventManager store events to send to MQTT
 EventManager eventManager;
 
@@ -67,6 +94,10 @@ EventManager eventManager;
 uint8_t nbHADevices = 0;
 HADevice **haDevices = NULL;
 
+//HAGroup variables
+uint8_t nbHAGroups = 0;
+HAGroup **haGroups = NULL;
+
 //ETHERNET variables
 byte mac[6];
 IPAddress ip;
@@ -78,7 +109,14 @@ WebServer webServer;
 EthernetClient mqttEthClient;
 PubSubClient mqttClient;
 bool needMqttReconnect = false;
-VerySimpleTimer mqttReconnectTimer;
+WheelTimer mqttReconnectTimer;
+DNSResolver mqttBrokerResolver;
+bool mqttUseFallback = false; //true when next connection has to target fallbackIP
+bool needMqttSnapshot = false;
+bool needMqttConfigPublish = false;
+WheelTimer mqttDiscoveryTimer; //pace Home Assistant discovery publish
+uint8_t mqttDiscoveryDevice = 0;    //HADevice to announce
+uint8_t mqttDiscoveryEntity = 0;    //entity of this HADevice to announce
 
 //---------UTILS---------
 void softwareReset()
@@ -90,7 +128,7 @@ void softwareReset()
 }
 
 //---------CONFIG---------
-bool configReadAndParseFromEEPROM(DynamicJsonDocument &configJSON, char *jsonBuffer, uint16_t jsonBufferSize)
+bool configReadAndParseFromEEPROM(JsonDocument &configJSON, char *jsonBuffer, uint16_t jsonBufferSize)
 {
   uint16_t i = 0;
   while (i < jsonBufferSize && EEPROM[i])
@@ -106,7 +144,15 @@ bool configReadAndParseFromEEPROM(DynamicJsonDocument &configJSON, char *jsonBuf
   return !jsonError;
 }
 
-void configReadSystemAndMQTT(DynamicJsonDocument &configJSON)
+//compute a hash of a part of JSON config (used to detect changes)
+uint16_t configHash(JsonVariant configPart)
+{
+  PrintCRC16 crc;
+  serializeJson(configPart, crc);
+  return crc.crc();
+}
+
+void configReadSystem(JsonDocument &configJSON)
 {
   //read System/name
   if (!configJSON[F("System")][F("name")].isNull() && strlen(configJSON[F("System")][F("name")].as<const char *>()) < sizeof(config.system.name))
@@ -129,6 +175,30 @@ void configReadSystemAndMQTT(DynamicJsonDocument &configJSON)
   config.system.ip.printTo(Serial);
   Serial.println();
 
+  //read System/ntp
+  if (!configJSON[F("System")][F("ntp")].isNull())
+  {
+    IPAddress tmpIP;
+    if (tmpIP.fromString(configJSON[F("System")][F("ntp")].as<const char *>()))
+      config.system.ntp = tmpIP;
+  }
+
+  //read System/timezone
+  config.system.timezone = configJSON[F("System")][F("timezone")] | 0;
+
+  Serial.print(F("[setup][Config] System/ntp="));
+  config.system.ntp.printTo(Serial);
+  Serial.print(',');
+  Serial.println(config.system.timezone);
+
+  configSystemHash = configHash(configJSON[F("System")]);
+}
+
+void configReadMQTT(JsonDocument &configJSON)
+{
+  //restart from default values
+  config.mqtt = decltype(config.mqtt)();
+
   //read MQTT/hostname
   if (!configJSON[F("MQTT")][F("hostname")].isNull() && strlen(configJSON[F("MQTT")][F("hostname")].as<const char *>()) < sizeof(config.mqtt.hostname))
     strcpy(config.mqtt.hostname, configJSON[F("MQTT")][F("hostname")].as<const char *>());
@@ -136,6 +206,18 @@ void configReadSystemAndMQTT(DynamicJsonDocument &configJSON)
   Serial.print(F("[setup][Config] MQTT/hostname="));
   Serial.println(config.mqtt.hostname);
 
+  //read MQTT/fallbackIP
+  if (!configJSON[F("MQTT")][F("fallbackIP")].isNull())
+  {
+    IPAddress tmpIP;
+    if (tmpIP.fromString(configJSON[F("MQTT")][F("fallbackIP")].as<const char *>()))
+      config.mqtt.fallbackIP = tmpIP;
+  }
+
+  Serial.print(F("[setup][Config] MQTT/fallbackIP="));
+  config.mqtt.fallbackIP.printTo(Serial);
+  Serial.println();
+
   //read MQTT/port
   config.mqtt.port = configJSON[F("MQTT")][F("port")] | config.mqtt.port;
 
@@ -164,16 +246,67 @@ void configReadSystemAndMQTT(DynamicJsonDocument &configJSON)
     strcpy(config.mqtt.baseTopic, configJSON[F("MQTT")][F("baseTopic")].as<const char *>());
   Serial.print(F("[setup][Config] MQTT/baseTopic="));
   Serial.println(config.mqtt.baseTopic);
+
+  configMQTTHash = configHash(configJSON[F("MQTT")]);
+}
+
+//read electrical limits used by ActuatorScheduler (defaults are used if missing)
+void configReadActuators(JsonDocument &configJSON)
+{
+  ActuatorScheduler::setup(configJSON[F("Actuators")][F("maxStarts")] | (uint8_t)ACTUATORSCHEDULER_DEFAULT_MAX_STARTS,
+                           configJSON[F("Actuators")][F("inrushTime")] | (uint16_t)ACTUATORSCHEDULER_DEFAULT_INRUSH_TIME,
+                           configJSON[F("Actuators")][F("deadTime")] | (uint16_t)ACTUATORSCHEDULER_DEFAULT_DEAD_TIME,
+                           configJSON[F("Actuators")][F("minDwell")] | (uint16_t)ACTUATORSCHEDULER_DEFAULT_MIN_DWELL);
 }
 
-void configSaveJsonToEEPROM(const char *json)
+//create one HADevice from its JSON config (NULL if type is unknown)
+HADevice *configCreateHADevice(JsonVariant deviceConfig)
 {
-  for (uint16_t i = 0; i < strlen(json); i++)
-    EEPROM[i] = json[i];
-  EEPROM[strlen(json)] = 0;
+  HADevice *device = NULL;
+  const char *type = deviceConfig[F("type")].as<const char *>();
+
+  if (!type)
+    return NULL;
+
+  //if device type is Light
+  if (!strcmp_P(type, PSTR("Light")))
+    device = new Light(deviceConfig, &eventManager); //create a Light
+  //if device type is RollerShutter
+  else if (!strcmp_P(type, PSTR("RollerShutter")))
+    device = new RollerShutter(deviceConfig, &eventManager); //create a RollerShutter
+  //if device type is DS18B20Bus
+  else if (!strcmp_P(type, PSTR("DS18B20Bus")))
+    device = new DS18B20Bus(deviceConfig, &eventManager); //create a DS18B20Bus
+  //if device type is PilotWire
+  else if (!strcmp_P(type, PSTR("PilotWire")))
+    device = new PilotWire(deviceConfig, &eventManager); //create a PilotWire
+  //if device type is DigitalOut
+  else if (!strcmp_P(type, PSTR("DigitalOut")))
+    device = new DigitalOut(deviceConfig, &eventManager); //create a DigitalOut
+  //if device type is DimmableLight
+  else if (!strcmp_P(type, PSTR("DimmableLight")))
+    device = new DimmableLight(deviceConfig, &eventManager); //create a DimmableLight
+  //if device type is PulseCounter
+  else if (!strcmp_P(type, PSTR("PulseCounter")))
+    device = new PulseCounter(deviceConfig, &eventManager); //create a PulseCounter
+  //if device type is AnalogIn
+  else if (!strcmp_P(type, PSTR("AnalogIn")))
+    device = new AnalogIn(deviceConfig, &eventManager); //create an AnalogIn
+  //if device type is DigitalIn
+  else if (!strcmp_P(type, PSTR("DigitalIn")))
+    device = new DigitalIn(deviceConfig, &eventManager); //create a DigitalIn
+  //if device type is Thermostat
+  else if (!strcmp_P(type, PSTR("Thermostat")))
+    device = new Thermostat(deviceConfig, &eventManager); //create a Thermostat
+
+  //keep config hash to detect changes at reload
+  if (device)
+    device->setConfigHash(configHash(deviceConfig));
+
+  return device;
 }
 
-void configCreateHADevices(DynamicJsonDocument &configJSON)
+void configCreateHADevices(JsonDocument &configJSON)
 {
   //if HADevices is in JSON and not empty
   if (!configJSON[F("HADevices")].isNull() && configJSON[F("HADevices")].size())
@@ -187,25 +320,280 @@ void configCreateHADevices(DynamicJsonDocument &configJSON)
     memset(haDevices, 0, nbHADevices * sizeof(HADevice *));
 
     //for each HADevices
+    for (uint8_t i = 0; i < nbHADevices; i++)
+      haDevices[i] = configCreateHADevice(configJSON[F("HADevices")][i]);
+  }
+}
+
+//rebuild HADevices references of HAGroups, rules and HADevices (to call after each change of HADevices array)
+void configResolveReferences()
+{
+  for (uint8_t i = 0; i < nbHAGroups; i++)
+    haGroups[i]->resolve(haDevices, nbHADevices);
+  RuleEngine::resolve(haDevices, nbHADevices);
+  for (uint8_t i = 0; i < nbHADevices; i++)
+    if (haDevices[i])
+      haDevices[i]->resolve(haDevices, nbHADevices);
+}
+
+//(re)create HAGroups from config ("Groups": {"name": ["id1","id2",...]})
+void configCreateHAGroups(JsonDocument &configJSON)
+{
+  for (uint8_t i = 0; i < nbHAGroups; i++)
+    delete haGroups[i];
+  if (haGroups)
+    delete[] haGroups;
+  haGroups = NULL;
+  nbHAGroups = 0;
+
+  JsonObject groupsJSON = configJSON[F("Groups")].as<JsonObject>();
+  if (!groupsJSON.isNull() && groupsJSON.size())
+  {
+    haGroups = new HAGroup *[groupsJSON.size()];
+    for (JsonPair group : groupsJSON)
+      haGroups[nbHAGroups++] = new HAGroup(group.key().c_str(), group.value().as<JsonArray>());
+  }
+
+  //HADevices references are resolved even without group
+  configResolveReferences();
+}
+
+//compile rules of config into EEPROM then link them to running HADevices
+void configCompileRules(JsonDocument &configJSON)
+{
+  RuleEngine::compile(configJSON[F("Rules")].as<JsonArray>());
+  //(HADevices references are rebuilt too : some of them may have been destroyed)
+  configResolveReferences();
+}
+
+//look for the HAGroup having this name (NULL if not found)
+HAGroup *configFindHAGroup(const char *name, size_t nameLength)
+{
+  for (uint8_t i = 0; i < nbHAGroups; i++)
+    if (strlen(haGroups[i]->getName()) == nameLength && !strncmp(haGroups[i]->getName(), name, nameLength))
+      return haGroups[i];
+  return NULL;
+}
+
+void mqttStartDiscovery();
+void mqttRemoveDiscovery(HADevice *device);
+
+//apply a new config to the running system :
+// - unchanged HADevices keep running untouched
+// - changed/removed HADevices are destroyed, changed/new ones are created
+// - MQTT changes only trigger a reconnection
+//return false if a restart is required (System part changed)
+//(warning : configJSON may be in globalBuffer, so globalBuffer can't be used here)
+bool configApply(JsonDocument &configJSON)
+{
+  //System (name, ip) is used everywhere, so restart is required
+  if (configHash(configJSON[F("System")]) != configSystemHash)
+    return false;
+
+  //if MQTT changed, disconnect then reconnect with new settings
+  bool mqttChanged = configHash(configJSON[F("MQTT")]) != configMQTTHash;
+  if (mqttChanged)
+  {
+    mqttClient.disconnect();
+    configReadMQTT(configJSON);
+    mqttBrokerResolver.begin(config.mqtt.hostname);
+    needMqttReconnect = true;
+  }
+
+  //electrical limits apply to next transitions
+  configReadActuators(configJSON);
+
+  uint8_t nbNewHADevices = configJSON[F("HADevices")].size();
+  HADevice **newHADevices = NULL;
+
+  if (nbNewHADevices)
+  {
+    newHADevices = new HADevice *[nbNewHADevices];
+    memset(newHADevices, 0, nbNewHADevices * sizeof(HADevice *));
+  }
+
+  //move unchanged (and running) HADevices to the new list
+  for (uint8_t newPos = 0; newPos < nbNewHADevices; newPos++)
+  {
+    uint16_t newHash = configHash(configJSON[F("HADevices")][newPos]);
     for (uint8_t i = 0; i < nbHADevices; i++)
     {
-      //if device type is Light
-      if (!strcmp_P(configJSON[F("HADevices")][i][F("type")].as<const char *>(), PSTR("Light")))
-        haDevices[i] = new Light(configJSON[F("HADevices")][i].as<JsonVariant>(), &eventManager); //create a Light
-      //if device type is RollerShutter
-      else if (!strcmp_P(configJSON[F("HADevices")][i][F("type")].as<const char *>(), PSTR("RollerShutter")))
-        haDevices[i] = new RollerShutter(configJSON[F("HADevices")][i].as<JsonVariant>(), &eventManager); //create a RollerShutter
-      //if device type is DS18B20Bus
-      else if (!strcmp_P(configJSON[F("HADevices")][i][F("type")].as<const char *>(), PSTR("DS18B20Bus")))
-        haDevices[i] = new DS18B20Bus(configJSON[F("HADevices")][i].as<JsonVariant>(), &eventManager); //create a DS18B20Bus
-      //if device type is PilotWire
-      else if (!strcmp_P(configJSON[F("HADevices")][i][F("type")].as<const char *>(), PSTR("PilotWire")))
-        haDevices[i] = new PilotWire(configJSON[F("HADevices")][i].as<JsonVariant>(), &eventManager); //create a PilotWire
-      //if device type is DigitalOut
-      else if (!strcmp_P(configJSON[F("HADevices")][i][F("type")].as<const char *>(), PSTR("DigitalOut")))
-        haDevices[i] = new DigitalOut(configJSON[F("HADevices")][i].as<JsonVariant>(), &eventManager); //create a DigitalOut
+      if (haDevices[i] && haDevices[i]->isInitialized() && haDevices[i]->getConfigHash() == newHash)
+      {
+        newHADevices[newPos] = haDevices[i];
+        haDevices[i] = NULL;
+        break;
+      }
     }
   }
+
+  //destroy remaining ones (this releases their pins)
+  for (uint8_t i = 0; i < nbHADevices; i++)
+  {
+    if (!haDevices[i])
+      continue;
+
+    Serial.print(F("[configApply] Remove "));
+    Serial.println(haDevices[i]->getId());
+
+    if (mqttClient.connected())
+    {
+      haDevices[i]->mqttUnsubscribe(mqttClient, config.mqtt.baseTopic);
+
+      //if this id disappears from config, remove it from Home Assistant too
+      bool idStillExists = false;
+      for (uint8_t newPos = 0; newPos < nbNewHADevices && !idStillExists; newPos++)
+        idStillExists = !strcmp(haDevices[i]->getId(), configJSON[F("HADevices")][newPos][F("id")] | "");
+      if (!idStillExists)
+        mqttRemoveDiscovery(haDevices[i]);
+    }
+
+    delete haDevices[i];
+  }
+  if (haDevices)
+    delete[] haDevices;
+
+  haDevices = newHADevices;
+  nbHADevices = nbNewHADevices;
+
+  //rules are compiled again before creating HADevices (their events are handled by new rules)
+  configCompileRules(configJSON);
+
+  //create changed and new HADevices
+  for (uint8_t i = 0; i < nbHADevices; i++)
+  {
+    if (haDevices[i])
+      continue;
+
+    haDevices[i] = configCreateHADevice(configJSON[F("HADevices")][i]);
+
+    if (haDevices[i] && mqttClient.connected() && !mqttChanged)
+      haDevices[i]->mqttSubscribe(mqttClient, config.mqtt.baseTopic);
+  }
+
+  //groups may have changed and their members were moved anyway
+  configCreateHAGroups(configJSON);
+
+  //refresh Home Assistant and publish all states
+  if (mqttClient.connected())
+  {
+    mqttStartDiscovery();
+    needMqttSnapshot = true;
+  }
+
+  return true;
+}
+
+//look for the running HADevice having this id (nbHADevices if not found)
+uint8_t configFindHADevice(const char *id)
+{
+  for (uint8_t i = 0; i < nbHADevices; i++)
+    if (haDevices[i] && !strcmp(haDevices[i]->getId(), id))
+      return i;
+  return nbHADevices;
+}
+
+//add or update one HADevices entry :
+// - only this entry is rewritten in EEPROM
+// - only this HADevice is (re)created
+//return NULL if succeed or an error message (PROGMEM)
+PGM_P configSetDevice(const char *deviceJson, size_t length)
+{
+  DynamicJsonDocument deviceJSON(CONFIG_DEVICE_JSONDOC_SIZE);
+  if (deserializeJson(deviceJSON, deviceJson, length))
+    return PSTR("HADevice JSON parse failed");
+
+  const char *id = deviceJSON[F("id")].as<const char *>();
+  if (!id || !id[0] || strlen(id) > 16)
+    return PSTR("id is missing or too long");
+  if (deviceJSON[F("type")].isNull())
+    return PSTR("type is missing");
+
+  //Save minified entry to EEPROM
+  char entry[CONFIG_DEVICE_MAX_LENGTH + 1];
+  if (measureJson(deviceJSON) >= sizeof(entry))
+    return PSTR("HADevice JSON is too long");
+  serializeJson(deviceJSON, entry, sizeof(entry));
+  if (!ConfigStore::setDevice(id, entry))
+    return PSTR("EEPROM config update failed");
+
+  uint8_t pos = configFindHADevice(id);
+
+  //running HADevice is already up to date
+  if (pos < nbHADevices && haDevices[pos]->isInitialized() && haDevices[pos]->getConfigHash() == configHash(deviceJSON.as<JsonVariant>()))
+    return NULL;
+
+  if (pos < nbHADevices)
+  {
+    //destroy previous HADevice (this releases its pins)
+    if (mqttClient.connected())
+      haDevices[pos]->mqttUnsubscribe(mqttClient, config.mqtt.baseTopic);
+    delete haDevices[pos];
+    haDevices[pos] = NULL;
+    configResolveReferences();
+  }
+  else
+  {
+    //grow HADevices array
+    HADevice **newHADevices = new HADevice *[nbHADevices + 1];
+    if (haDevices)
+    {
+      memcpy(newHADevices, haDevices, nbHADevices * sizeof(HADevice *));
+      delete[] haDevices;
+    }
+    haDevices = newHADevices;
+    pos = nbHADevices++;
+    //events published during creation are dispatched to HADevices
+    haDevices[pos] = NULL;
+  }
+
+  Serial.print(F("[configSetDevice] Create "));
+  Serial.println(id);
+
+  haDevices[pos] = configCreateHADevice(deviceJSON.as<JsonVariant>());
+  configResolveReferences();
+
+  if (haDevices[pos] && mqttClient.connected())
+  {
+    haDevices[pos]->mqttSubscribe(mqttClient, config.mqtt.baseTopic);
+    mqttStartDiscovery();
+    needMqttSnapshot = true;
+  }
+
+  return NULL;
+}
+
+//remove one HADevices entry (from EEPROM and running ones)
+//return NULL if succeed or an error message (PROGMEM)
+PGM_P configRemoveDevice(const char *id)
+{
+  if (!ConfigStore::removeDevice(id))
+    return PSTR("id not found");
+
+  uint8_t pos = configFindHADevice(id);
+  if (pos == nbHADevices)
+    return NULL;
+
+  Serial.print(F("[configRemoveDevice] Remove "));
+  Serial.println(id);
+
+  if (mqttClient.connected())
+  {
+    haDevices[pos]->mqttUnsubscribe(mqttClient, config.mqtt.baseTopic);
+    mqttRemoveDiscovery(haDevices[pos]);
+  }
+  delete haDevices[pos];
+
+  //compact HADevices array
+  nbHADevices--;
+  memmove(haDevices + pos, haDevices + pos + 1, (nbHADevices - pos) * sizeof(HADevice *));
+  configResolveReferences();
+
+  //discovery in progress walks the array, so restart it
+  if (mqttDiscoveryTimer.isActive())
+    mqttStartDiscovery();
+
+  return NULL;
 }
 
 //---------ETHERNET---------
@@ -257,6 +645,25 @@ bool ethernetConnect(uint8_t *mac, IPAddress &requestedIP)
 }
 
 //---------WEBSERVER---------
+//answer to a partial config request (error is NULL if succeed)
+void webServerAnswerConfigResult(EthernetClient &webClient, PGM_P error)
+{
+  if (error)
+  {
+    Serial.print(F("[WebServerCallback] Config update failed : "));
+    Serial.println((const __FlashStringHelper *)error);
+    strcpy_P(globalBuffer, PSTR("HTTP/1.1 400 Bad Request\r\nConnection: close\r\n\r\n"));
+    strcat_P(globalBuffer, error);
+  }
+  else
+    strcpy_P(globalBuffer, PSTR("HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Type: text/html\r\n\r\nConfig updated"));
+
+  webClient.write(globalBuffer, strlen(globalBuffer));
+
+  delay(1);         //give webClient time to receive the data
+  webClient.stop(); //close the connection
+}
+
 void webServerCallback(EthernetClient &webClient, bool isPOSTRequest, const char *requestURI, bool isFileContentReceived, const char *fileContent)
 {
   //if GET request
@@ -272,6 +679,8 @@ void webServerCallback(EthernetClient &webClient, bool isPOSTRequest, const char
     bool return404 = true;
     const uint8_t *contentPtr = NULL;
     uint16_t contentSize = 0;
+    bool contentFromConfigStore = false;
+    bool contentFromHistories = false;
 
     if (!strcmp_P(requestURI, PSTR("/pure-min.css")))
     {
@@ -334,6 +743,20 @@ void webServerCallback(EthernetClient &webClient, bool isPOSTRequest, const char
       sprintf_P(globalBuffer + strlen(globalBuffer), PSTR("{\"n\":\"%s\",\"b\":\"%s\",\"u\":\"%dd%02dh%02dm\"}"), config.system.name, VERSION, (minutes / 1440), (minutes / 60 % 24), (minutes % 60));
       return404 = false;
     }
+    else if (!strcmp_P(requestURI, PSTR("/conf")))
+    {
+      //build Header (content is streamed from EEPROM)
+      sprintf_P(globalBuffer, PSTR("HTTP/1.1 200 OK\r\nConnection: close\r\nAccept-Ranges: none\r\nCache-Control: no-cache\r\nContent-Type: text/json\r\nContent-Length: %d\r\n\r\n"), ConfigStore::length());
+      contentFromConfigStore = true;
+      return404 = false;
+    }
+    else if (!strcmp_P(requestURI, PSTR("/history")))
+    {
+      //build Header (content is streamed from HADevices histories, length is unknown : end of content is connection close)
+      strcpy_P(globalBuffer, PSTR("HTTP/1.1 200 OK\r\nConnection: close\r\nAccept-Ranges: none\r\nCache-Control: no-cache\r\nContent-Type: text/csv\r\n\r\n"));
+      contentFromHistories = true;
+      return404 = false;
+    }
 
     //Answer to the client
     if (!return404)
@@ -341,6 +764,24 @@ void webServerCallback(EthernetClient &webClient, bool isPOSTRequest, const char
       //Send Header
       webClient.write(globalBuffer, strlen(globalBuffer));
 
+      //Send config stored in EEPROM
+      if (contentFromConfigStore)
+      {
+        PrintChunked chunkedClient(webClient, (uint8_t *)globalBuffer, sizeof(globalBuffer));
+        ConfigStore::printTo(chunkedClient);
+        chunkedClient.flush();
+      }
+
+      //Send histories (decoded while sent)
+      if (contentFromHistories)
+      {
+        PrintChunked chunkedClient(webClient, (uint8_t *)globalBuffer, sizeof(globalBuffer));
+        for (uint8_t i = 0; i < nbHADevices; i++)
+          if (haDevices[i])
+            haDevices[i]->printHistory(chunkedClient);
+        chunkedClient.flush();
+      }
+
       //Then Send Content
       for (uint16_t pos = 0; pos < contentSize; pos += 1024)
       {
@@ -395,7 +836,7 @@ void webServerCallback(EthernetClient &webClient, bool isPOSTRequest, const char
         Serial.println(F("[WebServerCallback] Save JSON to EEPROM"));
 
         //Save JSON to EEPROM
-        configSaveJsonToEEPROM(fileContent);
+        ConfigStore::save(fileContent);
 
         //Answer to the webClient
         webClient.println(F("HTTP/1.1 200 OK\r\nContent-Type: text/html\r\n\r\nJSON Config file saved"));
@@ -403,8 +844,13 @@ void webServerCallback(EthernetClient &webClient, bool isPOSTRequest, const char
         delay(1);         //give webClient time to receive the data
         webClient.stop(); //close the connection
 
-        Serial.println(F("[WebServerCallback] Reboot"));
-        softwareReset();
+        //Apply new config without restart if possible
+        Serial.println(F("[WebServerCallback] Apply new config"));
+        if (!configApply(configJSONInGlobalBuffer))
+        {
+          Serial.println(F("[WebServerCallback] Reboot"));
+          softwareReset();
+        }
       }
       else
       {
@@ -435,16 +881,196 @@ void webServerCallback(EthernetClient &webClient, bool isPOSTRequest, const char
         }
       }
     }
+    //if one HADevices entry is POSTed (add or update)
+    else if (!strcmp_P(requestURI, PSTR("/conf/device")))
+    {
+      PGM_P error = configSetDevice(fileContent, strlen(fileContent));
+      webServerAnswerConfigResult(webClient, error);
+    }
+    //if one HADevices entry removal is POSTed ({"id":"..."})
+    else if (!strcmp_P(requestURI, PSTR("/conf/device/delete")))
+    {
+      StaticJsonDocument<64> requestJSON;
+      PGM_P error = PSTR("id is missing");
+      if (!deserializeJson(requestJSON, fileContent) && requestJSON[F("id")].is<const char *>())
+        error = configRemoveDevice(requestJSON[F("id")].as<const char *>());
+      webServerAnswerConfigResult(webClient, error);
+    }
   }
 }
 
 //---------MQTT---------
+//build baseTopic(with ending /) + name + suffix into buffer and return its length
+size_t mqttBuildSystemTopic(char *buffer, const char *suffixP)
+{
+  strcpy(buffer, config.mqtt.baseTopic);
+  if (buffer[strlen(buffer) - 1] != '/')
+    strcat_P(buffer, PSTR("/"));
+  strcat(buffer, config.system.name);
+  strcat_P(buffer, suffixP);
+  return strlen(buffer);
+}
+
+//print state of all HADevices as one JSON object
+void mqttPrintSnapshot(Print &out)
+{
+  bool withSeparator = false;
+
+  out.print('{');
+  for (uint8_t i = 0; i < nbHADevices; i++)
+    if (haDevices[i])
+      withSeparator |= haDevices[i]->printState(out, withSeparator);
+  out.print('}');
+}
+
+//publish state of all HADevices in one message streamed from devices states
+bool mqttPublishSnapshot()
+{
+  //first pass : measure payload length (required by MQTT header)
+  PrintCounter payloadCounter;
+  mqttPrintSnapshot(payloadCounter);
+
+  //topic is built at the beginning of globalBuffer, remaining part is used to chunk payload writes
+  size_t topicSize = mqttBuildSystemTopic(globalBuffer, PSTR("/snapshot")) + 1;
+
+  //second pass : stream payload to the broker
+  if (!mqttClient.beginPublish(globalBuffer, payloadCounter.count(), false))
+    return false;
+  PrintChunked chunkedClient(mqttClient, (uint8_t *)globalBuffer + topicSize, sizeof(globalBuffer) - topicSize);
+  mqttPrintSnapshot(chunkedClient);
+  chunkedClient.flush();
+
+  return mqttClient.endPublish();
+}
+
+//publish config stored in EEPROM (streamed, not retained)
+bool mqttPublishConfig()
+{
+  //topic is built at the beginning of globalBuffer, remaining part is used to chunk payload writes
+  size_t topicSize = mqttBuildSystemTopic(globalBuffer, PSTR("/config")) + 1;
+
+  if (!mqttClient.beginPublish(globalBuffer, ConfigStore::length(), false))
+    return false;
+  PrintChunked chunkedClient(mqttClient, (uint8_t *)globalBuffer + topicSize, sizeof(globalBuffer) - topicSize);
+  ConfigStore::printTo(chunkedClient);
+  chunkedClient.flush();
+
+  return mqttClient.endPublish();
+}
+
+//publish result of a partial config request (error is NULL if succeed)
+void mqttPublishConfigResult(PGM_P error)
+{
+  mqttBuildSystemTopic(globalBuffer, PSTR("/config/result"));
+  char *result = globalBuffer + strlen(globalBuffer) + 1;
+  strcpy_P(result, error ? error : PSTR("OK"));
+  mqttClient.publish(globalBuffer, result);
+}
+
+//build discovery topic : prefix/component/name/id[_subId]/config
+void mqttBuildDiscoveryTopic(char *buffer, PGM_P component, HADevice *device, const char *subId)
+{
+  strcpy_P(buffer, PSTR(HA_DISCOVERY_PREFIX "/"));
+  strcat_P(buffer, component);
+  strcat_P(buffer, PSTR("/"));
+  strcat(buffer, config.system.name);
+  strcat_P(buffer, PSTR("/"));
+  strcat(buffer, device->getId());
+  if (subId[0])
+  {
+    strcat_P(buffer, PSTR("_"));
+    strcat(buffer, subId);
+  }
+  strcat_P(buffer, PSTR("/config"));
+}
+
+//remove all entities of a HADevice from Home Assistant (empty retained config)
+void mqttRemoveDiscovery(HADevice *device)
+{
+  PGM_P component;
+  PGM_P payloadTemplate;
+  char subId[17];
+  char topic[sizeof(HA_DISCOVERY_PREFIX) + 14 + 17 + 17 + 17 + 7]; //prefix/component/name/id_subId/config
+
+  for (uint8_t entity = 0; (subId[0] = 0, device->getDiscovery(entity, component, payloadTemplate, subId)); entity++)
+  {
+    mqttBuildDiscoveryTopic(topic, component, device, subId);
+    mqttClient.publish(topic, (const uint8_t *)"", 0, true);
+  }
+}
+
+//restart Home Assistant discovery from first HADevice
+void mqttStartDiscovery()
+{
+  mqttDiscoveryDevice = 0;
+  mqttDiscoveryEntity = 0;
+  mqttDiscoveryTimer.setTimeout(HA_DISCOVERY_INTERVAL);
+}
+
+//publish next Home Assistant discovery config (retained)
+//return false when all HADevices entities are published
+bool mqttPublishNextDiscovery()
+{
+  PGM_P component;
+  PGM_P payloadTemplate;
+  char subId[17];
+
+  //look for next entity to announce
+  while (mqttDiscoveryDevice < nbHADevices)
+  {
+    subId[0] = 0;
+    if (haDevices[mqttDiscoveryDevice] && haDevices[mqttDiscoveryDevice]->getDiscovery(mqttDiscoveryEntity, component, payloadTemplate, subId))
+      break;
+    mqttDiscoveryDevice++;
+    mqttDiscoveryEntity = 0;
+  }
+  if (mqttDiscoveryDevice >= nbHADevices)
+    return false;
+
+  HADevice *device = haDevices[mqttDiscoveryDevice];
+  mqttDiscoveryEntity++;
+
+  mqttBuildDiscoveryTopic(globalBuffer, component, device, subId);
+
+  //first pass : measure payload length
+  PrintCounter payloadCounter;
+  HADiscovery::expand(payloadCounter, payloadTemplate, config.mqtt.baseTopic, config.system.name, device->getId(), subId);
+
+  //second pass : expand template directly into the MQTT socket (by small chunks)
+  if (mqttClient.beginPublish(globalBuffer, payloadCounter.count(), true))
+  {
+    uint8_t chunk[64];
+    PrintChunked chunkedClient(mqttClient, chunk, sizeof(chunk));
+    HADiscovery::expand(chunkedClient, payloadTemplate, config.mqtt.baseTopic, config.system.name, device->getId(), subId);
+    chunkedClient.flush();
+    mqttClient.endPublish();
+  }
+
+  return true;
+}
+
 // Connect then Subscribe to MQTT
 bool mqttConnect()
 {
   if (Ethernet.linkStatus() == LinkOFF)
     return false;
 
+  bool hasFallback = (uint32_t)config.mqtt.fallbackIP != 0;
+
+  //if broker address is not (yet) resolved, only fallback can be used
+  if (!mqttBrokerResolver.hasAddress())
+  {
+    if (!hasFallback)
+      return false;
+    mqttUseFallback = true;
+  }
+
+  //Set server by IP (no DNS request during connection)
+  if (mqttUseFallback && hasFallback)
+    mqttClient.setServer(config.mqtt.fallbackIP, config.mqtt.port);
+  else
+    mqttClient.setServer(mqttBrokerResolver.getAddress(), config.mqtt.port);
+
   //Generate CLientID
   char clientID[18];
   sprintf_P(clientID, PSTR("%02x:%02x:%02x:%02x:%02x:%02x"), mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
@@ -455,12 +1081,41 @@ bool mqttConnect()
   else
     mqttClient.connect(clientID, config.mqtt.username, config.mqtt.password);
 
+  //if connection failed, then next try will target the other broker address
+  if (!mqttClient.connected())
+    mqttUseFallback = !mqttUseFallback && hasFallback;
+
   //Subscribe to needed topic
   if (mqttClient.connected())
   {
+    //snapshot request topic
+    mqttBuildSystemTopic(globalBuffer, PSTR("/snapshot/get"));
+    mqttClient.subscribe(globalBuffer);
+
+    //partial config topics (get, set, delete)
+    mqttBuildSystemTopic(globalBuffer, PSTR("/config/+"));
+    mqttClient.subscribe(globalBuffer);
+
+    //group commands topic (groups can be added by config update)
+    strcpy(globalBuffer, config.mqtt.baseTopic);
+    if (globalBuffer[strlen(globalBuffer) - 1] != '/')
+      strcat_P(globalBuffer, PSTR("/"));
+    strcat_P(globalBuffer, PSTR("group/+/command"));
+    mqttClient.subscribe(globalBuffer);
+
     for (uint8_t i = 0; i < nbHADevices; i++)
       if (haDevices[i])
         haDevices[i]->mqttSubscribe(mqttClient, config.mqtt.baseTopic);
+
+    //Home Assistant status topic (discovery is published again when HA restarts)
+    strcpy_P(globalBuffer, PSTR(HA_DISCOVERY_PREFIX "/status"));
+    mqttClient.subscribe(globalBuffer);
+
+    //state may have changed while disconnected, so publish a snapshot
+    needMqttSnapshot = true;
+
+    //announce HADevices to Home Assistant
+    mqttStartDiscovery();
   }
 
   return mqttClient.connected();
@@ -468,11 +1123,72 @@ bool mqttConnect()
 
 void mqttCallback(char *topic, uint8_t *payload, unsigned int length)
 {
+  //if Home Assistant just started, then announce HADevices again
+  if (!strcmp_P(topic, PSTR(HA_DISCOVERY_PREFIX "/status")))
+  {
+    if (length == 6 && !strncmp_P((char *)payload, PSTR("online"), 6))
+      mqttStartDiscovery();
+    return;
+  }
+
   char *relevantPartOfTopic = topic + strlen(config.mqtt.baseTopic);
   if (config.mqtt.baseTopic[strlen(config.mqtt.baseTopic) - 1] != '/')
     relevantPartOfTopic++;
 
   bool messageHandled = false;
+  bool isSystemTopic = !strncmp(relevantPartOfTopic, config.system.name, strlen(config.system.name));
+  const char *systemTopicSuffix = relevantPartOfTopic + strlen(config.system.name);
+
+  //if snapshot is requested (name/snapshot/get)
+  if (isSystemTopic && !strcmp_P(systemTopicSuffix, PSTR("/snapshot/get")))
+  {
+    needMqttSnapshot = true;
+    messageHandled = true;
+  }
+
+  //if config is requested (name/config/get)
+  if (isSystemTopic && !strcmp_P(systemTopicSuffix, PSTR("/config/get")))
+  {
+    needMqttConfigPublish = true;
+    messageHandled = true;
+  }
+
+  //if one HADevices entry is received (name/config/set)
+  //(PubSubClient buffer is reused by publish, so topic and payload can't be used after that)
+  if (isSystemTopic && !strcmp_P(systemTopicSuffix, PSTR("/config/set")))
+  {
+    mqttPublishConfigResult(configSetDevice((const char *)payload, length));
+    return;
+  }
+
+  //if one HADevices entry removal is received (name/config/delete with id as payload)
+  if (isSystemTopic && !strcmp_P(systemTopicSuffix, PSTR("/config/delete")))
+  {
+    char id[16 + 1];
+    PGM_P error = PSTR("id is missing or too long");
+    if (length && length < sizeof(id))
+    {
+      memcpy(id, payload, length);
+      id[length] = 0;
+      error = configRemoveDevice(id);
+    }
+    mqttPublishConfigResult(error);
+    return;
+  }
+
+  //if a group command is received (group/name/command), dispatch it to all members at once
+  if (!messageHandled && !strncmp_P(relevantPartOfTopic, PSTR("group/"), 6))
+  {
+    const char *groupName = relevantPartOfTopic + 6;
+    const char *groupSuffix = strchr(groupName, '/');
+    if (groupSuffix && !strcmp_P(groupSuffix, PSTR("/command")))
+    {
+      HAGroup *group = configFindHAGroup(groupName, groupSuffix - groupName);
+      if (group)
+        group->command(payload, length);
+      return;
+    }
+  }
 
   for (uint8_t i = 0; i < nbHADevices && !messageHandled; i++)
     if (haDevices[i])
@@ -482,7 +1198,14 @@ void mqttCallback(char *topic, uint8_t *payload, unsigned int length)
 bool mqttStart()
 {
   //setup MQTT client (PubSubClient)
-  mqttClient.setClient(mqttEthClient).setServer(config.mqtt.hostname, config.mqtt.port).setCallback(mqttCallback);
+  mqttClient.setClient(mqttEthClient).setCallback(mqttCallback);
+  mqttClient.setBufferSize(MQTT_BUFFER_SIZE);
+
+  //Resolve broker hostname (only once at startup we wait for the answer)
+  mqttBrokerResolver.begin(config.mqtt.hostname);
+  do
+    mqttBrokerResolver.run();
+  while (mqttBrokerResolver.isResolving());
 
   //Then connect
   if (mqttConnect())
@@ -493,6 +1216,9 @@ bool mqttStart()
 
 void mqttRun()
 {
+  //Refresh broker address in background when cached one expires
+  mqttBrokerResolver.run();
+
   //If MQTT need to be reconnected
   if (needMqttReconnect)
   {
@@ -518,6 +1244,32 @@ void mqttRun()
 
   //Run mqttClient
   mqttClient.loop();
+
+  //publish snapshot if requested
+  if (needMqttSnapshot && mqttClient.connected())
+  {
+    needMqttSnapshot = false;
+    if (!mqttPublishSnapshot())
+      Serial.println(F("[MQTTRun] Snapshot publish : Failed"));
+  }
+
+  //publish config if requested
+  if (needMqttConfigPublish && mqttClient.connected())
+  {
+    needMqttConfigPublish = false;
+    if (!mqttPublishConfig())
+      Serial.println(F("[MQTTRun] Config publish : Failed"));
+  }
+}
+
+//---------EVENTS---------
+//each event published by a HADevice goes to rules then to HADevices (local reactions, without MQTT)
+void dispatchEvent(const char *topic, const char *payload)
+{
+  RuleEngine::onEvent(topic, payload);
+  for (uint8_t i = 0; i < nbHADevices; i++)
+    if (haDevices[i])
+      haDevices[i]->onEvent(topic, payload);
 }
 
 //---------SETUP---------
@@ -533,7 +1285,9 @@ void setup()
   Serial.println(F("[setup]Config JSON"));
   if (configReadAndParseFromEEPROM(configJSON, globalBuffer, sizeof(globalBuffer)))
   {
-    configReadSystemAndMQTT(configJSON);
+    configReadSystem(configJSON);
+    configReadMQTT(configJSON);
+    configReadActuators(configJSON);
     Serial.println(F("[setup]Config JSON : OK\n"));
   }
   else
@@ -544,6 +1298,17 @@ void setup()
   configCreateHADevices(configJSON);
   Serial.println(F("[setup]HADevices : Done\n"));
 
+  //Create Groups of HADevices
+  Serial.println(F("[setup]HAGroups"));
+  configCreateHAGroups(configJSON);
+  Serial.println(F("[setup]HAGroups : Done\n"));
+
+  //Compile Rules (local reactions to HADevices events)
+  Serial.println(F("[setup]Rules"));
+  configCompileRules(configJSON);
+  eventManager.setListener(dispatchEvent);
+  Serial.println(F("[setup]Rules : Done\n"));
+
   //Start Ethernet
   Serial.println(F("[setup]Ethernet"));
 
@@ -560,6 +1325,9 @@ void setup()
   else
     Serial.println(F("[setup]Ethernet : FAILED\n"));
 
+  //Start clock (synchronized in background)
+  SNTPClock::begin(config.system.ntp, config.system.timezone);
+
   //Start WebServer
   Serial.println(F("[setup]WebServer"));
   webServer.begin(webServerCallback);
@@ -578,11 +1346,30 @@ void loop()
 {
   bool timeCriticalOperationInProgress = false;
 
+  //------------------------TIMERS------------------------
+  //tag expired timers (devices only check a flag after that)
+  TimerWheel::run();
+
   //------------------------HOME AUTOMATION------------------------
+  //relay transitions requested by HADevices are queued
+  ActuatorScheduler::hold();
+
   for (uint8_t i = 0; i < nbHADevices; i++)
     if (haDevices[i])
       timeCriticalOperationInProgress |= haDevices[i]->run();
 
+  //Confort-1/Confort-2 pulses of PilotWires (only when an edge is due)
+  PilotWireScheduler::run();
+
+  //then applied in one pass (with the ones delayed by electrical limits)
+  timeCriticalOperationInProgress |= ActuatorScheduler::release();
+
+  //temperature buses cycles (one 1-Wire transaction per loop)
+  DS18B20Coordinator::run();
+
+  //------------------------CLOCK------------------------
+  SNTPClock::run();
+
   //------------------------WEBSERVER------------------------
   //if no time critical operation is in progress, then execute WebServer operation
   if (!timeCriticalOperationInProgress)
@@ -590,6 +1377,10 @@ void loop()
 
   //------------------------MQTT------------------------
   mqttRun();
+  //publish Home Assistant discovery one entity at a time (out of time critical operations)
+  if (!timeCriticalOperationInProgress && mqttDiscoveryTimer.isTimeoutOver() && mqttClient.connected())
+    if (!mqttPublishNextDiscovery())
+      mqttDiscoveryTimer.stop();
   //publish Events
   EventManager::Event *evtToSend;
   bool publishSucceeded = true;
@@ -600,11 +1391,20 @@ void loop()
     strcpy(globalBuffer, config.mqtt.baseTopic);
     if (globalBuffer[strlen(globalBuffer) - 1] != '/')
       strcat_P(globalBuffer, PSTR("/"));
-    strcat(globalBuffer, evtToSend->topic);
+    EventManager::buildTopic(evtToSend, globalBuffer + strlen(globalBuffer));
     //publish
     if ((publishSucceeded = mqttClient.publish(globalBuffer, evtToSend->payload)))
       evtToSend->sent = true; //if that works, then tag event as sent
     else
       evtToSend->retryLeft--; //else decrease retry count
   }
+
+  //------------------------IDLE------------------------
+  //if no timer expires before next millis tick, sleep until next interrupt
+  //(Timer0 interrupt wakes CPU up every ms, so Ethernet and buttons are still polled)
+  if (!timeCriticalOperationInProgress && TimerWheel::idleTime() > 1)
+  {
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_mode();
+  }
 }
\ No newline at end of file